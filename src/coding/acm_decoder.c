@@ -40,63 +40,8 @@ typedef int (*filler_t)(ACMStream *acm, unsigned ind, unsigned col);
 
 /* NB: bits <= 31!  Thus less checks in code. */
 
-static int get_bits_reload(ACMStream *acm, unsigned bits)
-{
-	int got;
-	unsigned data, b_data, b_avail;
-
-	data = acm->bit_data;
-	got = acm->bit_avail;
-	bits -= got;
-
-    switch (acm->data_len - acm->buf_start_ofs) {
-        case 0:
-            b_data = 0;
-            b_avail = 8;
-            break;
-        case 1:
-            b_data = (uint8_t)read_8bit(acm->buf_start_ofs,acm->streamfile);
-            b_avail = 8;
-            acm->buf_start_ofs += 1;
-            break;
-        case 2:
-            b_data = (uint16_t)read_16bitLE(acm->buf_start_ofs,acm->streamfile);
-            b_avail = 16;
-            acm->buf_start_ofs += 2;
-            break;
-        case 3:
-            b_data = (uint8_t)read_8bit(acm->buf_start_ofs,acm->streamfile);
-            b_data |= (int32_t)(uint16_t)read_16bitLE(acm->buf_start_ofs+1,acm->streamfile)<<8;
-            b_avail = 24;
-            acm->buf_start_ofs += 3;
-            break;
-        case 4:
-        default:
-            if (acm->data_len - acm->buf_start_ofs <= 0) {
-                b_data = 0;
-                b_avail = 8;
-                break;
-            }
-
-            b_data = read_32bitLE(acm->buf_start_ofs,acm->streamfile);
-            b_avail = 32;
-            acm->buf_start_ofs += 4;
-            break;
-    }
-
-	data |= (b_data & ((1 << bits) - 1)) << got;
-	acm->bit_data = b_data >> bits;
-	acm->bit_avail = b_avail - bits;
-	return data;
-}
-
 #define GET_BITS_NOERR(tmpval, acm, bits) do { \
-		if (acm->bit_avail >= bits) { \
-			tmpval = acm->bit_data & ((1 << bits) - 1); \
-			acm->bit_data >>= bits; \
-			acm->bit_avail -= bits; \
-		} else \
-			tmpval = get_bits_reload(acm, bits); \
+		tmpval = bitreader_get(&acm->br, bits); \
 	} while (0)
 
 #define GET_BITS(res, acm, bits) do { \
@@ -705,6 +650,7 @@ int acm_open_decoder(ACMStream **res, STREAMFILE *facilitator_file,
     }
 
     acm->data_len = get_streamfile_size(acm->streamfile);
+    bitreader_open(&acm->br, acm->streamfile, 0, acm->data_len, 0);
 
 	/* read header data */
 	err = ACM_ERR_NOT_ACM;
@@ -806,13 +752,11 @@ void acm_close(ACMStream *acm)
 
 void acm_reset(ACMStream *acm)
 {
-    acm->bit_avail = 0;
-    acm->bit_data = 0;
+    bitreader_open(&acm->br, acm->streamfile, ACM_HEADER_LEN, acm->data_len, 0);
 
     acm->stream_pos = 0;
     acm->block_pos = 0;
     acm->block_ready = 0;
-    acm->buf_start_ofs = ACM_HEADER_LEN;
 
     memset(acm->wrapbuf, 0, acm->wrapbuf_len * sizeof(int));
 }
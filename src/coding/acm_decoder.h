@@ -21,6 +21,7 @@
 #define __LIBACM_H
 
 #include "../streamfile.h"
+#include "bitreader.h"
 
 #define LIBACM_VERSION "1.0-svn"
 
@@ -57,9 +58,7 @@ struct ACMStream {
 	unsigned data_len;
 
 	/* acm stream buffer */
-	unsigned bit_avail;
-	unsigned bit_data;
-	unsigned buf_start_ofs;
+	bitreader br;
 
 	/* block lengths (in samples) */
 	unsigned block_len;
@@ -34,9 +34,22 @@ void decode_adx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
     stream->adpcm_history2_32 = hist2;
 }
 
-void adx_next_key(VGMSTREAMCHANNEL * stream)
-{
-    stream->adx_xor = ( stream->adx_xor * stream->adx_mult + stream->adx_add ) & 0x7fff;
+/* The key is an LCG, key = (key * mult + add) & 0x7fff, stepped once per
+ * frame. Steps are affine maps, and two of them make another one
+ * (a*(a*x+c)+c = a*a*x + (a+1)*c), so the key after any number of steps
+ * takes one squaring per bit of it rather than a step per frame. */
+uint16_t adx_key_at(uint16_t start, uint16_t mult, uint16_t add, int32_t steps) {
+    uint32_t a = mult & 0x7fff, c = add & 0x7fff;
+    uint16_t key = start;
+
+    while (steps > 0) {
+        if (steps & 1)
+            key = (key * a + c) & 0x7fff;
+        c = (a * c + c) & 0x7fff;
+        a = (a * a) & 0x7fff;
+        steps >>= 1;
+    }
+    return key;
 }
 
 void decode_adx_enc(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
@@ -45,7 +58,14 @@ void decode_adx_enc(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 
     int framesin = first_sample/32;
 
-    int32_t scale = ((read_16bitBE(stream->offset+framesin*18,stream->streamfile) ^ stream->adx_xor)&0x1fff) + 1;
+    /* adx_xor is the key of the channel's first frame, it steps once for
+     * each frame of every channel from there, so the key for any frame
+     * doesn't depend on the ones decoded before */
+    off_t frame_offset = stream->offset+framesin*18;
+    uint16_t key = adx_key_at(stream->adx_xor,stream->adx_mult,stream->adx_add,
+            (frame_offset-stream->channel_start_offset)/18);
+
+    int32_t scale = ((read_16bitBE(frame_offset,stream->streamfile) ^ key)&0x1fff) + 1;
     int32_t hist1 = stream->adpcm_history1_32;
     int32_t hist2 = stream->adpcm_history2_32;
     int coef1 = stream->adpcm_coef[0];
@@ -70,12 +90,4 @@ void decode_adx_enc(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_history2_32 = hist2;
-
-    if (!(i % 32)) {
-        for (i=0;i<stream->adx_channels;i++)
-        {
-            adx_next_key(stream);
-        }
-    }
-
 }
@@ -0,0 +1,60 @@
+#include <string.h>
+#include "bitreader.h"
+
+static inline uint64_t get_64bitLE(const uint8_t * p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1]<<8) | ((uint64_t)p[2]<<16) | ((uint64_t)p[3]<<24) |
+        ((uint64_t)p[4]<<32) | ((uint64_t)p[5]<<40) | ((uint64_t)p[6]<<48) | ((uint64_t)p[7]<<56);
+}
+
+/* keep the unread bytes and read the next chunk after them, past the end of
+ * the data (or a failed read) the buffer is filled with pad */
+static void fill_buffer(bitreader * br) {
+    size_t left = br->buf_len - br->buf_pos;
+    size_t to_read = BITREADER_BUFFER_SIZE - left;
+    size_t bytes_read = 0;
+
+    memmove(br->buf, br->buf + br->buf_pos, left);
+
+    if (br->next_offset < br->end_offset) {
+        if ((off_t)to_read > br->end_offset - br->next_offset)
+            to_read = (size_t)(br->end_offset - br->next_offset);
+        bytes_read = read_streamfile(br->buf + left, br->next_offset, to_read, br->streamfile);
+        br->next_offset += bytes_read;
+        if (bytes_read < to_read)
+            br->next_offset = br->end_offset;
+    }
+
+    if (br->next_offset >= br->end_offset) {
+        /* nothing more to read, pad until the end of the buffer */
+        memset(br->buf + left + bytes_read, br->pad, BITREADER_BUFFER_SIZE + 8 - left - bytes_read);
+        br->buf_len = BITREADER_BUFFER_SIZE;
+    }
+    else {
+        br->buf_len = left + bytes_read;
+    }
+    br->buf_pos = 0;
+}
+
+void bitreader_open(bitreader * br, STREAMFILE * streamfile, off_t offset, off_t end_offset, uint8_t pad) {
+    br->streamfile = streamfile;
+    br->next_offset = offset;
+    br->end_offset = end_offset;
+    br->pad = pad;
+    br->buf_pos = 0;
+    br->buf_len = 0;
+    br->bits = 0;
+    br->bits_avail = 0;
+}
+
+void bitreader_refill(bitreader * br) {
+    /* whole bytes that still fit in the word, the partial byte after them
+     * gets or'd in again by the next refill at the same position */
+    int bytes = (63 - br->bits_avail) >> 3;
+
+    if (br->buf_len - br->buf_pos < 8)
+        fill_buffer(br);
+
+    br->bits |= get_64bitLE(br->buf + br->buf_pos) << br->bits_avail;
+    br->buf_pos += bytes;
+    br->bits_avail += bytes*8;
+}
@@ -0,0 +1,48 @@
+/*
+ * bitreader.h - LSB-first bit reader over a STREAMFILE, for codecs with
+ * variable length codes (NWA, ACM)
+ */
+
+#ifndef _BITREADER_H
+#define _BITREADER_H
+
+#include "../streamfile.h"
+
+#define BITREADER_BUFFER_SIZE 0x1000
+
+typedef struct {
+    STREAMFILE * streamfile;
+    off_t next_offset;      /* file offset of the next buffer fill */
+    off_t end_offset;       /* data ends here, bytes after it read as pad */
+    uint8_t pad;
+
+    /* bytes read from the file, with room for a whole word past buf_len */
+    uint8_t buf[BITREADER_BUFFER_SIZE + 8];
+    size_t buf_pos;
+    size_t buf_len;
+
+    /* bits not consumed yet, the next one is bit 0 */
+    uint64_t bits;
+    int bits_avail;
+} bitreader;
+
+/* start reading at offset, end_offset is usually the file size */
+void bitreader_open(bitreader * br, STREAMFILE * streamfile, off_t offset, off_t end_offset, uint8_t pad);
+
+/* top up br->bits to at least 57 bits */
+void bitreader_refill(bitreader * br);
+
+/* get 0 to 32 bits */
+static inline uint32_t bitreader_get(bitreader * br, int bits) {
+    uint32_t ret;
+
+    if (br->bits_avail < bits)
+        bitreader_refill(br);
+
+    ret = (uint32_t)(br->bits & (((uint64_t)1 << bits) - 1));
+    br->bits >>= bits;
+    br->bits_avail -= bits;
+    return ret;
+}
+
+#endif
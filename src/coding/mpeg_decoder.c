@@ -6,6 +6,57 @@
 #include "coding.h"
 #include "../util.h"
 
+/* AHX frames start with a fixed header */
+static const uint8_t ahx_header[4] = {0xff,0xf5,0xe0,0xc0};
+
+/* offset of the first AHX header in buf, or -1 */
+static int find_ahx_header(const uint8_t * buf, int size) {
+    const uint8_t * p = buf;
+    const uint8_t * end = buf + size - 4;
+
+    while (p <= end) {
+        p = memchr(p, ahx_header[0], end - p + 1);
+        if (!p) break;
+        if (!memcmp(p, ahx_header, 4)) return p - buf;
+        p++;
+    }
+    return -1;
+}
+
+/* Frame index, the offsets of frames in file order. Frames are added as
+ * they are found, and the size of a frame followed by a known one doesn't
+ * need a search on later passes (after a loop or reset). */
+static int32_t find_indexed_frame(mpeg_codec_data * data, off_t offset) {
+    int32_t lo = 0, hi = data->frame_count - 1;
+
+    /* usually the next one */
+    if (data->frame_cursor < data->frame_count &&
+            data->frame_offsets[data->frame_cursor] == offset)
+        return data->frame_cursor;
+
+    while (lo <= hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if (data->frame_offsets[mid] == offset) return mid;
+        if (data->frame_offsets[mid] < offset) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+static void add_indexed_frame(mpeg_codec_data * data, off_t offset) {
+    if (data->frame_count > 0 && data->frame_offsets[data->frame_count-1] >= offset)
+        return;
+
+    if (data->frame_count == data->frame_capacity) {
+        int32_t capacity = data->frame_capacity ? data->frame_capacity * 2 : 256;
+        off_t * frame_offsets = realloc(data->frame_offsets, capacity * sizeof(off_t));
+        if (!frame_offsets) return; /* just not indexed */
+        data->frame_offsets = frame_offsets;
+        data->frame_capacity = capacity;
+    }
+    data->frame_offsets[data->frame_count++] = offset;
+}
+
 /* mono, mpg123 expects frames of 0x414 (160kbps, 22050Hz) but they
  * actually vary and are much shorter */
 void decode_fake_mpeg2_l2(VGMSTREAMCHANNEL *stream,
@@ -19,49 +70,40 @@ void decode_fake_mpeg2_l2(VGMSTREAMCHANNEL *stream,
 
         if (!data->buffer_full) {
             /* fill buffer up to next frame ending (or file ending) */
-            int bytes_into_header = 0;
-            const uint8_t header[4] = {0xff,0xf5,0xe0,0xc0};
-            off_t frame_offset = 0;
-
-            /* assume that we are starting at a header, skip it and look for the
-             * next one */
-            read_streamfile(data->buffer, stream->offset+frame_offset, 4,
-                    stream->streamfile);
-            frame_offset += 4;
-
-            do {
-                uint8_t byte;
-                byte =
-                    read_8bit(stream->offset+frame_offset,stream->streamfile);
-                data->buffer[frame_offset] = byte;
-                frame_offset++;
-
-                if (byte == header[bytes_into_header]) {
-                    bytes_into_header++;
-                } else {
-                    /* This might have been the first byte of the header, so
-                     * we need to check again.
-                     * No need to get more complicated than this, though, since
-                     * there are no repeated characters in the search string. */
-                    if (bytes_into_header>0) {
-                        frame_offset--;
-                    }
-                    bytes_into_header=0;
-                }
-
-                if (bytes_into_header==4) {
-                    break;
-                }
-            } while (frame_offset < AHX_EXPECTED_FRAME_SIZE);
-
-            if (bytes_into_header==4) frame_offset-=4;
-            memset(data->buffer+frame_offset,0,
-                    AHX_EXPECTED_FRAME_SIZE-frame_offset);
+            size_t bytes_read;
+            int frame_size = -1;
+            int32_t frame = find_indexed_frame(data, stream->offset);
+
+            /* like read_8bit, anything past the file end reads as 0xff */
+            bytes_read = read_streamfile(data->buffer, stream->offset,
+                    AHX_EXPECTED_FRAME_SIZE, stream->streamfile);
+            memset(data->buffer+bytes_read,0xff,
+                    AHX_EXPECTED_FRAME_SIZE-bytes_read);
+
+            if (frame >= 0 && frame+1 < data->frame_count) {
+                frame_size = data->frame_offsets[frame+1] - data->frame_offsets[frame];
+            }
+            else {
+                /* assume that we are starting at a header, skip it and look
+                 * for the next one */
+                frame_size = find_ahx_header(data->buffer+4,
+                        AHX_EXPECTED_FRAME_SIZE-4);
+                if (frame_size >= 0) frame_size += 4;
+
+                add_indexed_frame(data, stream->offset);
+                if (frame_size >= 0)
+                    add_indexed_frame(data, stream->offset + frame_size);
+            }
+            if (frame_size < 0) frame_size = AHX_EXPECTED_FRAME_SIZE;
+            if (frame >= 0) data->frame_cursor = frame + 1;
+
+            memset(data->buffer+frame_size,0,
+                    AHX_EXPECTED_FRAME_SIZE-frame_size);
 
             data->buffer_full = 1;
             data->buffer_used = 0;
 
-            stream->offset += frame_offset;
+            stream->offset += frame_size;
         }
 
         if (!data->buffer_used) {
@@ -85,6 +127,96 @@ void decode_fake_mpeg2_l2(VGMSTREAMCHANNEL *stream,
     }
 }
 
+/* MPEG frame header fields needed to find the next frame */
+typedef struct {
+    int version;        /* 1, 2, or 3 for 2.5 */
+    int layer;
+    int sample_rate;
+    int frame_size;
+} mpeg_frame_info;
+
+static const int mpeg_bitrates[5][16] = {
+    {0,32,64,96,128,160,192,224,256,288,320,352,384,416,448,0}, /* MPEG1 L1 */
+    {0,32,48,56, 64, 80, 96,112,128,160,192,224,256,320,384,0}, /* MPEG1 L2 */
+    {0,32,40,48, 56, 64, 80, 96,112,128,160,192,224,256,320,0}, /* MPEG1 L3 */
+    {0,32,48,56, 64, 80, 96,112,128,144,160,176,192,224,256,0}, /* MPEG2/2.5 L1 */
+    {0, 8,16,24, 32, 40, 48, 56, 64, 80, 96,112,128,144,160,0}, /* MPEG2/2.5 L2/L3 */
+};
+
+static const int mpeg_sample_rates[3] = {44100,48000,32000};
+
+/* parse a frame header, 0 if it can't be one (free format isn't supported) */
+static int parse_mpeg_header(uint32_t header, mpeg_frame_info * info) {
+    int version_bits = (header >> 19) & 3;
+    int layer_bits = (header >> 17) & 3;
+    int bitrate_index = (header >> 12) & 0xf;
+    int rate_index = (header >> 10) & 3;
+    int padding = (header >> 9) & 1;
+    int bitrate;
+
+    if ((header & 0xffe00000) != 0xffe00000) return 0;
+    if (version_bits == 1 || layer_bits == 0) return 0;
+    if (bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) return 0;
+    if ((header & 3) == 2) return 0; /* reserved emphasis */
+
+    info->version = version_bits == 3 ? 1 : (version_bits == 2 ? 2 : 3);
+    info->layer = 4 - layer_bits;
+    info->sample_rate = mpeg_sample_rates[rate_index] >> (info->version - 1);
+
+    if (info->version == 1)
+        bitrate = mpeg_bitrates[info->layer - 1][bitrate_index] * 1000;
+    else
+        bitrate = mpeg_bitrates[info->layer == 1 ? 3 : 4][bitrate_index] * 1000;
+
+    if (info->layer == 1)
+        info->frame_size = (12 * bitrate / info->sample_rate + padding) * 4;
+    else if (info->layer == 3 && info->version != 1)
+        info->frame_size = 72 * bitrate / info->sample_rate + padding;
+    else
+        info->frame_size = 144 * bitrate / info->sample_rate + padding;
+
+    return 1;
+}
+
+/* Find the first frame header between offset and end that is followed by
+ * another frame of the same kind, searching for sync bytes in buffered
+ * windows. Returns -1 if there is none. */
+static off_t find_mpeg_frame(STREAMFILE *streamfile, off_t offset, off_t end) {
+    uint8_t buf[MPEG_SYNC_WINDOW_SIZE];
+
+    while (offset < end) {
+        size_t bytes = read_streamfile(buf, offset, sizeof(buf), streamfile);
+        const uint8_t * p = buf;
+        const uint8_t * last;
+
+        if (bytes < 4) break;
+        last = buf + bytes - 4;
+
+        while (p <= last) {
+            mpeg_frame_info info, next;
+            p = memchr(p, 0xff, last - p + 1);
+            if (!p) break;
+
+            if (parse_mpeg_header(get_32bitBE((uint8_t *)p), &info)) {
+                off_t frame_offset = offset + (p - buf);
+                uint32_t next_header = read_32bitBE(frame_offset + info.frame_size, streamfile);
+
+                if (parse_mpeg_header(next_header, &next) &&
+                        next.version == info.version &&
+                        next.layer == info.layer &&
+                        next.sample_rate == info.sample_rate)
+                    return frame_offset;
+            }
+            p++;
+        }
+
+        /* the last 3 bytes may start a header */
+        offset += bytes - 3;
+    }
+
+    return -1;
+}
+
 mpeg_codec_data *init_mpeg_codec_data(STREAMFILE *streamfile, off_t start_offset, long given_sample_rate, int given_channels, coding_t *coding_type, int * actual_sample_rate, int * actual_channels) {
     int rc;
     off_t read_offset;
@@ -108,14 +240,17 @@ mpeg_codec_data *init_mpeg_codec_data(STREAMFILE *streamfile, off_t start_offset
         goto mpeg_fail;
     }
 
-    /* check format */
-    read_offset=0;
+    /* check format, feeding from the first frame found (or the start if
+     * frames aren't contiguous, mpg123 will sync by itself) */
+    read_offset = find_mpeg_frame(streamfile, start_offset,
+            start_offset + MPEG_SYNC_SEARCH_SIZE);
+    if (read_offset < 0) read_offset = start_offset;
     do {
         size_t bytes_done;
-        if (read_streamfile(data->buffer, start_offset+read_offset,
+        if (read_streamfile(data->buffer, read_offset,
                     MPEG_BUFFER_SIZE,streamfile) !=
                 MPEG_BUFFER_SIZE) goto mpeg_fail;
-        read_offset+=1;
+        read_offset += MPEG_BUFFER_SIZE;
         rc = mpg123_decode(data->m,data->buffer,MPEG_BUFFER_SIZE,
                 NULL,0,&bytes_done);
         if (rc != MPG123_OK && rc != MPG123_NEW_FORMAT &&
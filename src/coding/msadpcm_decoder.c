@@ -41,10 +41,16 @@ void decode_msadpcm_stereo(VGMSTREAM * vgmstream, sample * outbuf, int32_t first
     offset = ch1->offset+framesin*get_vgmstream_frame_size(vgmstream);
 
     if (first_sample==0) {
-        ch1->adpcm_coef[0] = ADPCMCoeffs[read_8bit(offset,streamfile)][0];
-        ch1->adpcm_coef[1] = ADPCMCoeffs[read_8bit(offset,streamfile)][1];
-        ch2->adpcm_coef[0] = ADPCMCoeffs[read_8bit(offset+1,streamfile)][0];
-        ch2->adpcm_coef[1] = ADPCMCoeffs[read_8bit(offset+1,streamfile)][1];
+        int coef_index1 = (uint8_t)read_8bit(offset,streamfile);
+        int coef_index2 = (uint8_t)read_8bit(offset+1,streamfile);
+
+        /* there are 7 standard coefficient sets */
+        if (coef_index1 > 6) coef_index1 = 0;
+        if (coef_index2 > 6) coef_index2 = 0;
+        ch1->adpcm_coef[0] = ADPCMCoeffs[coef_index1][0];
+        ch1->adpcm_coef[1] = ADPCMCoeffs[coef_index1][1];
+        ch2->adpcm_coef[0] = ADPCMCoeffs[coef_index2][0];
+        ch2->adpcm_coef[1] = ADPCMCoeffs[coef_index2][1];
         ch1->adpcm_scale = read_16bitLE(offset+2,streamfile);
         ch2->adpcm_scale = read_16bitLE(offset+4,streamfile);
         ch1->adpcm_history1_16 = read_16bitLE(offset+6,streamfile);
@@ -114,8 +120,12 @@ void decode_msadpcm_mono(VGMSTREAM * vgmstream, sample * outbuf, int32_t first_s
     offset = ch1->offset+framesin*get_vgmstream_frame_size(vgmstream);
 
     if (first_sample==0) {
-        ch1->adpcm_coef[0] = ADPCMCoeffs[read_8bit(offset,streamfile)][0];
-        ch1->adpcm_coef[1] = ADPCMCoeffs[read_8bit(offset,streamfile)][1];
+        int coef_index = (uint8_t)read_8bit(offset,streamfile);
+
+        /* there are 7 standard coefficient sets */
+        if (coef_index > 6) coef_index = 0;
+        ch1->adpcm_coef[0] = ADPCMCoeffs[coef_index][0];
+        ch1->adpcm_coef[1] = ADPCMCoeffs[coef_index][1];
         ch1->adpcm_scale = read_16bitLE(offset+1,streamfile);
         ch1->adpcm_history1_16 = read_16bitLE(offset+3,streamfile);
         ch1->adpcm_history2_16 = read_16bitLE(offset+5,streamfile);
@@ -51,3 +51,70 @@ void decode_ngc_dtk(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
     stream->adpcm_history1_32 = hist1;
     stream->adpcm_history2_32 = hist2;
 }
+
+/* predictor coefficients for q>>4, with no prediction for the unused values */
+static const int32_t dtk_coefs[16][2] = {
+    { 0x00,  0x00 },
+    { 0x3c,  0x00 },
+    { 0x73, -0x34 },
+    { 0x62, -0x37 },
+};
+
+/* Decode both channels of a stereo stream together: each 32 byte frame
+ * (2 header bytes + 2 unused, then 28 bytes with the left sample in the low
+ * nibble and the right one in the high nibble) is read once and both
+ * channels are output in the same pass. */
+void decode_ngc_dtk_stereo(VGMSTREAM * vgmstream, sample * outbuf, int32_t first_sample, int32_t samples_to_do) {
+    VGMSTREAMCHANNEL * stream = &vgmstream->ch[0];
+    uint8_t frame[32];
+    size_t bytes_read;
+    int i;
+    int32_t sample_count;
+
+    int framesin = first_sample/28;
+
+    int32_t hist1_l = vgmstream->ch[0].adpcm_history1_32;
+    int32_t hist2_l = vgmstream->ch[0].adpcm_history2_32;
+    int32_t hist1_r = vgmstream->ch[1].adpcm_history1_32;
+    int32_t hist2_r = vgmstream->ch[1].adpcm_history2_32;
+    int32_t coef1_l, coef2_l, coef1_r, coef2_r;
+    int shift_l, shift_r;
+
+    /* bytes that can't be read are 0xFF, as read_8bit returns -1 */
+    bytes_read = read_streamfile(frame,framesin*32+stream->offset,32,stream->streamfile);
+    if (bytes_read < 32)
+        memset(frame+bytes_read,0xFF,32-bytes_read);
+
+    coef1_l = dtk_coefs[frame[0]>>4][0];
+    coef2_l = dtk_coefs[frame[0]>>4][1];
+    shift_l = frame[0] & 0xf;
+    coef1_r = dtk_coefs[frame[1]>>4][0];
+    coef2_r = dtk_coefs[frame[1]>>4][1];
+    shift_r = frame[1] & 0xf;
+
+    first_sample = first_sample%28;
+
+    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=2) {
+        uint8_t sample_byte = frame[4+i];
+        int32_t hist;
+
+        hist = (hist1_l*coef1_l + hist2_l*coef2_l + 0x20)>>6;
+        if (hist >  0x1fffff) hist =  0x1fffff;
+        if (hist < -0x200000) hist = -0x200000;
+        hist2_l = hist1_l;
+        hist1_l = ((get_low_nibble_signed(sample_byte) << 12) >> shift_l) * 64 + hist;
+        outbuf[sample_count] = clamp16(hist1_l >> 6);
+
+        hist = (hist1_r*coef1_r + hist2_r*coef2_r + 0x20)>>6;
+        if (hist >  0x1fffff) hist =  0x1fffff;
+        if (hist < -0x200000) hist = -0x200000;
+        hist2_r = hist1_r;
+        hist1_r = ((get_high_nibble_signed(sample_byte) << 12) >> shift_r) * 64 + hist;
+        outbuf[sample_count+1] = clamp16(hist1_r >> 6);
+    }
+
+    vgmstream->ch[0].adpcm_history1_32 = hist1_l;
+    vgmstream->ch[0].adpcm_history2_32 = hist2_l;
+    vgmstream->ch[1].adpcm_history1_32 = hist1_r;
+    vgmstream->ch[1].adpcm_history2_32 = hist2_r;
+}
@@ -33,21 +33,6 @@
 #include <stdlib.h>
 #include "nwa_decoder.h"
 
-/* can serve up 8 bits at a time */
-static int
-getbits (STREAMFILE *file, off_t *offset, int *shift, int bits)
-{
-	int ret;
-    if (*shift > 8)
-    {
-        ++*offset;
-        *shift -= 8;
-    }
-    ret = read_16bitLE(*offset,file) >> *shift;
-    *shift += bits;
-    return ret & ((1 << bits) - 1);	/* mask */
-}
-
 NWAData *
 open_nwa (STREAMFILE * streamFile, const char *filename)
 {
@@ -187,7 +172,6 @@ nwa_decode_block(NWAData *nwa)
     {
         sample d[2];
         int i;
-        int shift = 0;
         off_t offset = nwa->offsets[nwa->curblock];
         int dsize = curblocksize / (nwa->bps / 8);
         int flip_flag = 0;			/* stereo  */
@@ -204,17 +188,20 @@ nwa_decode_block(NWAData *nwa)
             }
         }
 
+        /* the codes may run into the next block, read up to the file end */
+        bitreader_open(&nwa->br, nwa->file, offset, nwa->compdatasize, 0xff);
+
         for (i = 0; i < dsize; i++)
         {
             if (runlength == 0)
             {						/* ԡ롼Ǥʤʤǡɤ߹ */
-                int type = getbits(nwa->file, &offset, &shift, 3);
+                int type = bitreader_get(&nwa->br, 3);
                 /* type ˤʬ0, 1-6, 7 */
                 if (type == 7)
                 {
                     /* 7 : 礭ʺʬ */
                     /* RunLength() ͭCompLevel==5, ե) Ǥ̵ */
-                    if (getbits(nwa->file, &offset, &shift, 1) == 1)
+                    if (bitreader_get(&nwa->br, 1) == 1)
                     {
                         d[flip_flag] = 0;	/* ̤ */
                     }
@@ -234,7 +221,7 @@ nwa_decode_block(NWAData *nwa)
 						{
 							const int MASK1 = (1 << (BITS - 1));
 							const int MASK2 = (1 << (BITS - 1)) - 1;
-							int b = getbits(nwa->file, &offset, &shift, BITS);
+							int b = bitreader_get(&nwa->br, BITS);
 							if (b & MASK1)
 								d[flip_flag] -= (b & MASK2) << SHIFT;
 							else
@@ -259,7 +246,7 @@ nwa_decode_block(NWAData *nwa)
 					{
 						const int MASK1 = (1 << (BITS - 1));
 						const int MASK2 = (1 << (BITS - 1)) - 1;
-						int b = getbits(nwa->file, &offset, &shift, BITS);
+						int b = bitreader_get(&nwa->br, BITS);
 						if (b & MASK1)
 							d[flip_flag] -= (b & MASK2) << SHIFT;
 						else
@@ -272,13 +259,13 @@ nwa_decode_block(NWAData *nwa)
                     if (use_runlength(nwa))
                     {
                         /* 󥰥̤ξ */
-                        runlength = getbits(nwa->file, &offset, &shift, 1);
+                        runlength = bitreader_get(&nwa->br, 1);
                         if (runlength == 1)
                         {
-                            runlength = getbits(nwa->file, &offset, &shift, 2);
+                            runlength = bitreader_get(&nwa->br, 2);
                             if (runlength == 3)
                             {
-                                runlength = getbits(nwa->file, &offset, &shift, 8);
+                                runlength = bitreader_get(&nwa->br, 8);
                             }
                         }
                     }
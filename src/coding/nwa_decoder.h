@@ -34,6 +34,7 @@
 #define _NWA_DECODER_H
 
 #include "../streamfile.h"
+#include "bitreader.h"
 
 typedef struct NWAData_s
 {
@@ -52,6 +53,7 @@ typedef struct NWAData_s
     off_t *offsets;
 
     STREAMFILE *file;
+    bitreader br;                   /* compressed data of the current block */
 
     /* temporarily store samples */
     sample *buffer;
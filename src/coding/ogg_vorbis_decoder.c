@@ -19,4 +19,24 @@ void decode_ogg_vorbis(ogg_vorbis_codec_data * data, sample * outbuf, int32_t sa
     } while (samples_done < samples_to_do);
 }
 
+void decode_ogg_vorbis_float(ogg_vorbis_codec_data * data, float * outbuf, int32_t samples_to_do, int channels) {
+    int samples_done = 0;
+    OggVorbis_File *ogg_vorbis_file = &data->ogg_vorbis_file;
+
+    do {
+        float **pcm;
+        int i, ch;
+        long rc = ov_read_float(ogg_vorbis_file, &pcm,
+                samples_to_do - samples_done, &data->bitstream);
+
+        if (rc <= 0) return;
+
+        for (i = 0; i < rc; i++) {
+            for (ch = 0; ch < channels; ch++)
+                outbuf[(samples_done + i)*channels + ch] = pcm[ch][i];
+        }
+        samples_done += rc;
+    } while (samples_done < samples_to_do);
+}
+
 #endif
@@ -1,5 +1,135 @@
 #include "coding.h"
 #include "../util.h"
+#include "../kernels.h"
+
+/* max channels decoded at once by the bulk path, more use the per-channel path */
+#define PCM_BULK_CHANNELS 16
+/* samples per channel converted per pass */
+#define PCM_BULK_SAMPLES 0x200
+
+/* Reads length bytes for the bulk path. Bytes that couldn't be read are set
+ * to 0xFF from the first incomplete sample, so they decode to the same -1 the
+ * read_8bit/read_16bit functions give on failure. */
+static void read_pcm_bytes(uint8_t * dest, off_t offset, size_t length, int bytes_per_sample, STREAMFILE * streamfile) {
+    size_t bytes_read = read_streamfile(dest,offset,length,streamfile);
+    if (bytes_read < length) {
+        bytes_read -= bytes_read % bytes_per_sample;
+        memset(dest+bytes_read,0xFF,length-bytes_read);
+    }
+}
+
+typedef void (*pcm_convert_fn)(sample * outbuf, const uint8_t * inbuf, int count);
+
+static pcm_convert_fn get_pcm_convert(coding_t coding_type, const vgmstream_kernels * kernels, int * bytes_per_sample) {
+    switch (coding_type) {
+        case coding_PCM16LE:
+        case coding_PCM16LE_int:
+        case coding_PCM16LE_XOR_int:
+            *bytes_per_sample = 2;
+            return kernels->pcm16LE;
+        case coding_PCM16BE:
+            *bytes_per_sample = 2;
+            return kernels->pcm16BE;
+        case coding_PCM8:
+        case coding_PCM8_int:
+            *bytes_per_sample = 1;
+            return kernels->pcm8;
+        case coding_PCM8_U:
+        case coding_PCM8_U_int:
+            *bytes_per_sample = 1;
+            return kernels->pcm8_unsigned;
+        case coding_PCM8_SB_int:
+            *bytes_per_sample = 1;
+            return kernels->pcm8_sb;
+        default:
+            return NULL;
+    }
+}
+
+/* Decode all channels of a PCM stream where each channel's samples are
+ * contiguous (not the _int codings). Returns 0 if the bulk path can't handle
+ * this stream, in which case nothing was decoded. */
+int decode_pcm_bulk(VGMSTREAM * vgmstream, sample * outbuf, int32_t first_sample, int32_t samples_to_do) {
+    const vgmstream_kernels * kernels = get_kernels();
+    int channels = vgmstream->channels;
+    int bytes_per_sample;
+    pcm_convert_fn convert = get_pcm_convert(vgmstream->coding_type,kernels,&bytes_per_sample);
+    uint8_t raw[PCM_BULK_SAMPLES*2];
+    sample chbuf[PCM_BULK_CHANNELS][PCM_BULK_SAMPLES];
+    sample * chbufs[PCM_BULK_CHANNELS];
+    int ch;
+
+    if (!convert || channels > PCM_BULK_CHANNELS)
+        return 0;
+
+    for (ch=0;ch<channels;ch++)
+        chbufs[ch] = chbuf[ch];
+
+    while (samples_to_do > 0) {
+        int count = samples_to_do > PCM_BULK_SAMPLES ? PCM_BULK_SAMPLES : samples_to_do;
+
+        for (ch=0;ch<channels;ch++) {
+            VGMSTREAMCHANNEL * stream = &vgmstream->ch[ch];
+            read_pcm_bytes(raw,stream->offset+first_sample*bytes_per_sample,
+                    count*bytes_per_sample,bytes_per_sample,stream->streamfile);
+            /* mono goes straight to the output */
+            convert(channels == 1 ? outbuf : chbuf[ch],raw,count);
+        }
+        if (channels > 1)
+            kernels->interleave(outbuf,chbufs,channels,count);
+
+        outbuf += count*channels;
+        first_sample += count;
+        samples_to_do -= count;
+    }
+
+    return 1;
+}
+
+/* Decode all channels of a sample-interleaved (_int) PCM stream at once. The
+ * file data is laid out like the output buffer, so when the channels are
+ * consecutive in the same file it's a straight conversion. Returns 0 if the
+ * channel layout doesn't allow it, in which case nothing was decoded. */
+int decode_pcm_int_bulk(VGMSTREAM * vgmstream, sample * outbuf, int32_t first_sample, int32_t samples_to_do) {
+    const vgmstream_kernels * kernels = get_kernels();
+    int channels = vgmstream->channels;
+    int bytes_per_sample;
+    pcm_convert_fn convert = get_pcm_convert(vgmstream->coding_type,kernels,&bytes_per_sample);
+    uint8_t raw[PCM_BULK_SAMPLES*2];
+    off_t offset;
+    int32_t total;
+    int ch;
+
+    if (!convert)
+        return 0;
+    for (ch=1;ch<channels;ch++) {
+        if (vgmstream->ch[ch].streamfile != vgmstream->ch[0].streamfile ||
+                vgmstream->ch[ch].offset != vgmstream->ch[0].offset+ch*bytes_per_sample)
+            return 0;
+    }
+
+    offset = vgmstream->ch[0].offset + (off_t)first_sample*channels*bytes_per_sample;
+    total = samples_to_do*channels;
+    while (total > 0) {
+        int count = total > PCM_BULK_SAMPLES ? PCM_BULK_SAMPLES : total;
+
+        read_pcm_bytes(raw,offset,count*bytes_per_sample,bytes_per_sample,vgmstream->ch[0].streamfile);
+        convert(outbuf,raw,count);
+
+        if (vgmstream->coding_type == coding_PCM16LE_XOR_int) {
+            int i;
+            /* passes don't necessarily start on the first channel */
+            for (i=0;i<count;i++)
+                outbuf[i] ^= vgmstream->ch[(samples_to_do*channels-total+i)%channels].key_xor;
+        }
+
+        outbuf += count;
+        offset += count*bytes_per_sample;
+        total -= count;
+    }
+
+    return 1;
+}
 
 void decode_pcm16LE(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
     int i;
@@ -1,6 +1,7 @@
 #include <math.h>
 #include "coding.h"
 #include "../util.h"
+#include "../kernels.h"
 
 double VAG_f[5][2] = { { 0.0          ,   0.0        },
                        {  60.0 / 64.0 ,   0.0        },
@@ -13,126 +14,160 @@ long VAG_coefs[5][2] = { {   0 ,   0 },
                          {  98 , -55 } ,
                          { 122 , -60 } } ;
 
-void decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-
-	int predict_nr, shift_factor, sample;
-	int32_t hist1=stream->adpcm_history1_32;
-	int32_t hist2=stream->adpcm_history2_32;
-
-	short scale;
-	int i;
-	int32_t sample_count;
-	uint8_t flag;
-
-	int framesin = first_sample/28;
+#define PSX_FRAME_SIZE 0x10
+#define PSX_FRAME_SAMPLES 28
+/* channels decoded together, more are done in groups */
+#define PSX_MAX_LANES 16
+
+enum { psx_normal, psx_badflags, psx_invert };
+
+/* Decode samples first_sample..first_sample+samples_to_do of the current
+ * frame of several channels at once, with outbuf[channel] holding the first
+ * sample of each channel. With outbuf_f set, samples go there as float
+ * instead and aren't clamped (the history never was).
+ *
+ * This is integer math but bit-exact with the old double filter: VAG_f are
+ * all n/64, so the double sum was exactly x/64 for an integer x and the int
+ * conversion truncated it toward zero, same as x/64 does. The innermost loop
+ * goes over the channels with no dependencies between them, so compilers can
+ * vectorize it. */
+static void decode_psx_lanes(VGMSTREAMCHANNEL * streams, int lanes, int mode, sample * outbuf, float * outbuf_f, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    const vgmstream_kernels * kernels = get_kernels();
+    int32_t scaled[PSX_FRAME_SAMPLES][PSX_MAX_LANES];
+    int32_t hist1[PSX_MAX_LANES], hist2[PSX_MAX_LANES];
+    int32_t coef1[PSX_MAX_LANES], coef2[PSX_MAX_LANES];
+    int framesin = first_sample/PSX_FRAME_SAMPLES;
+    int i, ch;
+    int32_t sample_count;
+
+    first_sample = first_sample % PSX_FRAME_SAMPLES;
+
+    for (ch=0;ch<lanes;ch++) {
+        VGMSTREAMCHANNEL * stream = &streams[ch];
+        uint8_t frame[PSX_FRAME_SIZE];
+        int16_t nibbles[PSX_FRAME_SAMPLES];
+        size_t bytes_read;
+        int predict_nr, shift_factor;
+
+        /* bytes that can't be read are 0xFF, as read_8bit returns -1 */
+        bytes_read = read_streamfile(frame,stream->offset+framesin*PSX_FRAME_SIZE,PSX_FRAME_SIZE,stream->streamfile);
+        if (bytes_read < PSX_FRAME_SIZE)
+            memset(frame+bytes_read,0xFF,PSX_FRAME_SIZE-bytes_read);
+
+        if (mode == psx_invert) {
+            frame[0] ^= stream->bmdx_xor;
+            frame[2] += stream->bmdx_add;
+        }
+
+        predict_nr = frame[0] >> 4;
+        shift_factor = frame[0] & 0xf;
+
+        hist1[ch] = stream->adpcm_history1_32;
+        hist2[ch] = stream->adpcm_history2_32;
+
+        /* end/skip frames decode as silence */
+        if (mode != psx_badflags && frame[1] >= 0x07) {
+            coef1[ch] = coef2[ch] = 0;
+            for (i=0;i<PSX_FRAME_SAMPLES;i++)
+                scaled[i][ch] = 0;
+            continue;
+        }
+
+        /* bad predictors used to read past VAG_f, now they don't predict */
+        if (predict_nr < 5) {
+            coef1[ch] = VAG_coefs[predict_nr][0];
+            coef2[ch] = VAG_coefs[predict_nr][1];
+        }
+        else {
+            coef1[ch] = coef2[ch] = 0;
+        }
+
+        kernels->adpcm_nibbles(nibbles,frame+2,PSX_FRAME_SAMPLES/2,shift_factor);
+        for (i=0;i<PSX_FRAME_SAMPLES;i++)
+            scaled[i][ch] = nibbles[i]*64;
+    }
+
+    if (outbuf_f) {
+        for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
+            for (ch=0;ch<lanes;ch++) {
+                int32_t sample = (scaled[i][ch] + hist1[ch]*coef1[ch] + hist2[ch]*coef2[ch]) / 64;
+
+                outbuf_f[sample_count+ch] = sample * (1.0f/32768.0f);
+                hist2[ch] = hist1[ch];
+                hist1[ch] = sample;
+            }
+        }
+    }
+    else {
+        for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
+            for (ch=0;ch<lanes;ch++) {
+                int32_t sample = (scaled[i][ch] + hist1[ch]*coef1[ch] + hist2[ch]*coef2[ch]) / 64;
+
+                outbuf[sample_count+ch] = clamp16(sample);
+                hist2[ch] = hist1[ch];
+                hist1[ch] = sample;
+            }
+        }
+    }
+
+    for (ch=0;ch<lanes;ch++) {
+        streams[ch].adpcm_history1_32 = hist1[ch];
+        streams[ch].adpcm_history2_32 = hist2[ch];
+    }
+}
 
-	predict_nr = read_8bit(stream->offset+framesin*16,stream->streamfile) >> 4;
-	shift_factor = read_8bit(stream->offset+framesin*16,stream->streamfile) & 0xf;
-	flag = read_8bit(stream->offset+framesin*16+1,stream->streamfile);
+static void decode_psx_all(VGMSTREAM * vgmstream, sample * outbuf, float * outbuf_f, int channels, int32_t first_sample, int32_t samples_to_do) {
+    int mode = psx_normal;
+    int ch;
+
+    if (vgmstream->coding_type == coding_PSX_badflags)
+        mode = psx_badflags;
+    else if (vgmstream->coding_type == coding_invert_PSX)
+        mode = psx_invert;
+
+    for (ch=0;ch<channels;ch+=PSX_MAX_LANES) {
+        int lanes = channels-ch > PSX_MAX_LANES ? PSX_MAX_LANES : channels-ch;
+        decode_psx_lanes(&vgmstream->ch[ch],lanes,mode,
+                outbuf ? outbuf+ch : NULL, outbuf_f ? outbuf_f+ch : NULL,
+                vgmstream->channels,first_sample,samples_to_do);
+    }
+}
 
-	first_sample = first_sample % 28;
-	
-	for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
+/* decode the first channels of a PSX/invert PSX/PSX badflags stream, all
+ * channels at the same position, into interleaved outbuf */
+void decode_psx_channels(VGMSTREAM * vgmstream, sample * outbuf, int channels, int32_t first_sample, int32_t samples_to_do) {
+    decode_psx_all(vgmstream,outbuf,NULL,channels,first_sample,samples_to_do);
+}
 
-		sample=0;
+/* same, as unclamped float */
+void decode_psx_channels_float(VGMSTREAM * vgmstream, float * outbuf, int channels, int32_t first_sample, int32_t samples_to_do) {
+    decode_psx_all(vgmstream,NULL,outbuf,channels,first_sample,samples_to_do);
+}
 
-		if(flag<0x07) {
-		
-			short sample_byte = (short)read_8bit(stream->offset+(framesin*16)+2+i/2,stream->streamfile);
+/* decode one channel of a PSX/invert PSX/PSX badflags stream */
+void decode_psx_channel(VGMSTREAM * vgmstream, int channel, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    int mode = psx_normal;
 
-			scale = ((i&1 ?
-				     sample_byte >> 4 :
-					 sample_byte & 0x0f)<<12);
+    if (vgmstream->coding_type == coding_PSX_badflags)
+        mode = psx_badflags;
+    else if (vgmstream->coding_type == coding_invert_PSX)
+        mode = psx_invert;
 
-			sample=(int)((scale >> shift_factor)+hist1*VAG_f[predict_nr][0]+hist2*VAG_f[predict_nr][1]);
-		}
+    decode_psx_lanes(&vgmstream->ch[channel],1,mode,outbuf,NULL,channelspacing,first_sample,samples_to_do);
+}
 
-		outbuf[sample_count] = clamp16(sample);
-		hist2=hist1;
-		hist1=sample;
-	}
-	stream->adpcm_history1_32=hist1;
-	stream->adpcm_history2_32=hist2;
+void decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    decode_psx_lanes(stream,1,psx_normal,outbuf,NULL,channelspacing,first_sample,samples_to_do);
 }
 
 void decode_invert_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-
-	int predict_nr, shift_factor, sample;
-	int32_t hist1=stream->adpcm_history1_32;
-	int32_t hist2=stream->adpcm_history2_32;
-
-	short scale;
-	int i;
-	int32_t sample_count;
-	uint8_t flag;
-
-	int framesin = first_sample/28;
-    int head = read_8bit(stream->offset+framesin*16,stream->streamfile) ^ stream->bmdx_xor;
-
-	predict_nr = ((head >> 4) & 0xf);
-	shift_factor = (head & 0xf);
-	flag = read_8bit(stream->offset+framesin*16+1,stream->streamfile);
-
-	first_sample = first_sample % 28;
-	
-	for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-
-		sample=0;
-
-		if(flag<0x07) {
-		
-			short sample_byte = (short)read_8bit(stream->offset+(framesin*16)+2+i/2,stream->streamfile);
-            if (i/2 == 0)
-                sample_byte = (short)(int8_t)(sample_byte+stream->bmdx_add);
-
-			scale = ((i&1 ?
-				     sample_byte >> 4 :
-					 sample_byte & 0x0f)<<12);
-
-			sample=(int)((scale >> shift_factor)+hist1*VAG_f[predict_nr][0]+hist2*VAG_f[predict_nr][1]);
-		}
-
-		outbuf[sample_count] = clamp16(sample);
-		hist2=hist1;
-		hist1=sample;
-	}
-	stream->adpcm_history1_32=hist1;
-	stream->adpcm_history2_32=hist2;
+    decode_psx_lanes(stream,1,psx_invert,outbuf,NULL,channelspacing,first_sample,samples_to_do);
 }
 
 /* some TAITO games have garbage (?) in their flags, this decoder
  * just ignores that byte */
 void decode_psx_badflags(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-
-	int predict_nr, shift_factor, sample;
-	int32_t hist1=stream->adpcm_history1_32;
-	int32_t hist2=stream->adpcm_history2_32;
-
-	short scale;
-	int i;
-	int32_t sample_count;
-
-	int framesin = first_sample/28;
-
-	predict_nr = read_8bit(stream->offset+framesin*16,stream->streamfile) >> 4;
-	shift_factor = read_8bit(stream->offset+framesin*16,stream->streamfile) & 0xf;
-	first_sample = first_sample % 28;
-	
-	for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        short sample_byte = (short)read_8bit(stream->offset+(framesin*16)+2+i/2,stream->streamfile);
-
-        scale = ((i&1 ?
-                    sample_byte >> 4 :
-                    sample_byte & 0x0f)<<12);
-
-        sample=(int)((scale >> shift_factor)+hist1*VAG_f[predict_nr][0]+hist2*VAG_f[predict_nr][1]);
-
-		outbuf[sample_count] = clamp16(sample);
-		hist2=hist1;
-		hist1=sample;
-	}
-	stream->adpcm_history1_32=hist1;
-	stream->adpcm_history2_32=hist2;
+    decode_psx_lanes(stream,1,psx_badflags,outbuf,NULL,channelspacing,first_sample,samples_to_do);
 }
 
 /* FF XI's Vag-ish format */
@@ -1,72 +1,109 @@
 #include "coding.h"
 #include "../util.h"
+#include "../kernels.h"
 
-const int SH = 4;
-const int SHC = 10;
-
-double K0[4] = { 0.0, 0.9375, 1.796875,  1.53125};
-double K1[4] = { 0.0,    0.0,  -0.8125,-0.859375};
-
-int IK0(int fid)
-{ return ((int)((-K0[fid]) * (1 << SHC))); }
-
-int IK1(int fid)
-{ return ((int)((-K1[fid]) * (1 << SHC))); }
-
-int CLAMP(int value, int Minim, int Maxim)
-{
-    if (value < Minim) value = Minim;
-    if (value > Maxim) value = Maxim;
-    return value;
-}
+/* filters as fixed point with 10 fractional bits, negated:
+ * 0.0/0.0, 0.9375/0.0, 1.796875/-0.8125, 1.53125/-0.859375 */
+static const int32_t xa_coefs[4][2] = {
+    {     0,   0 },
+    {  -960,   0 },
+    { -1840, 832 },
+    { -1568, 880 }
+};
 
 void init_get_high_nibble(VGMSTREAM *vgmstream) {
 	vgmstream->get_high_nibble=1;
 }
 
-void decode_xa(VGMSTREAM * vgmstream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
-
-    VGMSTREAMCHANNEL * stream = &(vgmstream->ch[channel]);
-	int predict_nr, shift_factor, sample;
-	int32_t hist1=stream->adpcm_history1_32;
-	int32_t hist2=stream->adpcm_history2_32;
-	int HeadTable[8]={0,2,8,10};
-
-	short scale;
-	int i;
-	int32_t sample_count;
-
-	int framesin = first_sample / (56 / channelspacing);
-
-
-	first_sample = first_sample % 28;
-	
-	vgmstream->get_high_nibble=!vgmstream->get_high_nibble;
-
-	if((first_sample) && (channelspacing==1))
-		vgmstream->get_high_nibble=!vgmstream->get_high_nibble;
-
-	predict_nr = read_8bit(stream->offset+HeadTable[framesin]+vgmstream->get_high_nibble,stream->streamfile) >> 4;
-	shift_factor = read_8bit(stream->offset+HeadTable[framesin]+vgmstream->get_high_nibble,stream->streamfile) & 0xf;
-
-	for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        short sample_byte = (short)read_8bit(stream->offset+16+framesin+(i*4),stream->streamfile);
-
-		scale = ((vgmstream->get_high_nibble ?
-			     sample_byte >> 4 :
-				 sample_byte & 0x0f)<<12);
-
-        sample = (short)(scale & 0xf000) >> shift_factor; 
-		sample <<= SH;
-        sample -= (IK0(predict_nr) * hist1 + (IK1(predict_nr) * hist2)) >> SHC; 
+#define HEADER_BYTE(unit) ((unit) < 4 ? (unit) : (unit)+4)
+
+/* decode one 28 sample sound unit from nibbles (every other value, already <<12) */
+static void decode_xa_unit(int32_t * history, const int16_t * nibbles, uint8_t param, sample * outbuf, int channelspacing) {
+    int32_t hist1=history[0];
+    int32_t hist2=history[1];
+    int predict_nr = (int8_t)param >> 4;
+    int shift_factor = param & 0xf;
+    int32_t coef1, coef2;
+    int i;
+
+    /* only 4 filters exist, others used to read past the table */
+    if (predict_nr < 0 || predict_nr > 3)
+        predict_nr = 0;
+    coef1 = xa_coefs[predict_nr][0];
+    coef2 = xa_coefs[predict_nr][1];
+
+    for (i=0;i<28;i++) {
+        /* 4 extra bits of precision, dropped on output */
+        int32_t sample = (nibbles[i*2] >> shift_factor) * 16;
+        sample -= (coef1*hist1 + coef2*hist2) >> 10;
+
+        hist2=hist1;
+        hist1=sample;
+
+        if (sample < -32768*16) sample = -32768*16;
+        if (sample > 32767*16) sample = 32767*16;
+        outbuf[i*channelspacing] = sample >> 4;
+    }
+
+    history[0]=hist1;
+    history[1]=hist2;
+}
 
-		hist2=hist1;
-		hist1=sample;
+/* Decode the whole 128 byte sound group at the current block: a 16 byte
+ * header with the params of 8 units, then 28 words holding one nibble of
+ * each unit. Stereo alternates units between channels. Output goes to the
+ * group cache, interleaved. The channels keep the history from the group
+ * start (so a loop start inside the group can decode it again), the one at
+ * its end is put in them when the next block is set up. */
+static void decode_xa_group(VGMSTREAM * vgmstream) {
+    const vgmstream_kernels * kernels = get_kernels();
+    VGMSTREAMCHANNEL * stream = &vgmstream->ch[0];
+    int channels = vgmstream->channels;
+    uint8_t group[0x80];
+    uint8_t unit_bytes[28];
+    int16_t nibbles[28*2];
+    size_t bytes_read;
+    int pair, i;
+
+    for (i=0;i<channels;i++) {
+        vgmstream->xa_group_history[i][0] = vgmstream->ch[i].adpcm_history1_32;
+        vgmstream->xa_group_history[i][1] = vgmstream->ch[i].adpcm_history2_32;
+    }
+
+    /* bytes that can't be read are 0xFF, as read_8bit returns -1 */
+    bytes_read = read_streamfile(group,stream->offset,0x80,stream->streamfile);
+    if (bytes_read < 0x80)
+        memset(group+bytes_read,0xFF,0x80-bytes_read);
+
+    /* both units of a pair share bytes, low nibble first */
+    for (pair=0;pair<4;pair++) {
+        for (i=0;i<28;i++)
+            unit_bytes[i] = group[16+i*4+pair];
+        kernels->adpcm_nibbles(nibbles,unit_bytes,28,0);
+
+        /* unit params are at 0..3 and 8..11 (copies at 4..7 and 12..15) */
+        if (channels == 2) {
+            decode_xa_unit(vgmstream->xa_group_history[0],nibbles,group[HEADER_BYTE(pair*2)],
+                    vgmstream->xa_group+pair*28*2,2);
+            decode_xa_unit(vgmstream->xa_group_history[1],nibbles+1,group[HEADER_BYTE(pair*2+1)],
+                    vgmstream->xa_group+pair*28*2+1,2);
+        }
+        else {
+            decode_xa_unit(vgmstream->xa_group_history[0],nibbles,group[HEADER_BYTE(pair*2)],
+                    vgmstream->xa_group+pair*2*28,1);
+            decode_xa_unit(vgmstream->xa_group_history[0],nibbles+1,group[HEADER_BYTE(pair*2+1)],
+                    vgmstream->xa_group+(pair*2+1)*28,1);
+        }
+    }
+
+    vgmstream->xa_group_decoded = 1;
+}
 
-		sample = CLAMP(sample, -32768 << SH, 32767 << SH);
-		outbuf[sample_count] = (short)(sample >> SH);
-	}
+/* output samples of the current sound group, decoding it on first use */
+void decode_xa(VGMSTREAM * vgmstream, sample * outbuf, int32_t first_sample, int32_t samples_to_do) {
+    if (!vgmstream->xa_group_decoded)
+        decode_xa_group(vgmstream);
 
-	stream->adpcm_history1_32=hist1;
-	stream->adpcm_history2_32=hist2;
+    memcpy(outbuf,vgmstream->xa_group+first_sample*vgmstream->channels,
+            samples_to_do*vgmstream->channels*sizeof(sample));
 }
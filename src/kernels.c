@@ -0,0 +1,728 @@
+#include <stdlib.h>
+#include <string.h>
+#include "kernels.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* x86 SIMD kernels are built with per-function target attributes, so the
+ * rest of the library doesn't need to be compiled with -msse2/-mavx2 */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define KERNELS_X86
+#define KERNELS_AVX2
+#include <cpuid.h>
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define KERNELS_X86
+#if _MSC_VER >= 1700
+#define KERNELS_AVX2
+#endif
+#include <intrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#ifdef KERNELS_AVX2
+#include <immintrin.h>
+#endif
+#define TARGET_SSE2
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+/* NEON can't be checked at runtime portably, it's used when the compiler targets it */
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__ARM_BIG_ENDIAN)
+#define KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+
+/* scalar versions, these define the expected output of the others */
+
+static void pcm16LE_scalar(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i;
+    for (i=0;i<count;i++)
+        outbuf[i] = (int16_t)(inbuf[i*2] | (inbuf[i*2+1]<<8));
+}
+
+static void pcm16BE_scalar(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i;
+    for (i=0;i<count;i++)
+        outbuf[i] = (int16_t)((inbuf[i*2]<<8) | inbuf[i*2+1]);
+}
+
+static void pcm8_scalar(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i;
+    for (i=0;i<count;i++)
+        outbuf[i] = (int8_t)inbuf[i]*0x100;
+}
+
+static void pcm8_unsigned_scalar(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i;
+    for (i=0;i<count;i++)
+        outbuf[i] = inbuf[i]*0x100 - 0x8000;
+}
+
+static void pcm8_sb_scalar(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i;
+    for (i=0;i<count;i++) {
+        int16_t v = inbuf[i];
+        if (v&0x80) v = 0-(v&0x7f);
+        outbuf[i] = v*0x100;
+    }
+}
+
+static void adpcm_nibbles_scalar(int16_t * outbuf, const uint8_t * inbuf, int bytes, int shift) {
+    int i;
+    for (i=0;i<bytes;i++) {
+        outbuf[i*2]   = (int16_t)((inbuf[i]&0x0f)<<12) >> shift;
+        outbuf[i*2+1] = (int16_t)((inbuf[i]&0xf0)<<8) >> shift;
+    }
+}
+
+static void fade_linear_scalar(sample * buf, int channels, int count, int32_t volume, int32_t volume_step) {
+    int i,ch;
+    for (i=0;i<count;i++) {
+        int32_t gain = volume >> 16; /* 2.14 */
+        for (ch=0;ch<channels;ch++) {
+            buf[i*channels+ch] = (buf[i*channels+ch]*gain) >> 14;
+        }
+        volume += volume_step;
+    }
+}
+
+static void interleave_scalar(sample * outbuf, sample ** inbufs, int channels, int count) {
+    int i,ch;
+    for (i=0;i<count;i++) {
+        for (ch=0;ch<channels;ch++) {
+            outbuf[i*channels+ch] = inbufs[ch][i];
+        }
+    }
+}
+
+static void deinterleave_scalar(sample ** outbufs, const sample * inbuf, int channels, int count) {
+    int i,ch;
+    for (i=0;i<count;i++) {
+        for (ch=0;ch<channels;ch++) {
+            outbufs[ch][i] = inbuf[i*channels+ch];
+        }
+    }
+}
+
+static void to_float_scalar(float * outbuf, const sample * inbuf, int count) {
+    int i;
+    for (i=0;i<count;i++)
+        outbuf[i] = inbuf[i] * (1.0f/32768.0f);
+}
+
+
+#ifdef KERNELS_X86
+/* SSE2: 8 samples per step (16 for 8-bit) */
+
+TARGET_SSE2
+static void pcm16LE_sse2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    /* x86 is little endian, this is a straight copy */
+    for (;i+8<=count;i+=8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i*2));
+        _mm_storeu_si128((__m128i *)(outbuf+i), v);
+    }
+    pcm16LE_scalar(outbuf+i,inbuf+i*2,count-i);
+}
+
+TARGET_SSE2
+static void pcm16BE_sse2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    for (;i+8<=count;i+=8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i*2));
+        v = _mm_or_si128(_mm_slli_epi16(v,8), _mm_srli_epi16(v,8));
+        _mm_storeu_si128((__m128i *)(outbuf+i), v);
+    }
+    pcm16BE_scalar(outbuf+i,inbuf+i*2,count-i);
+}
+
+TARGET_SSE2
+static void pcm8_sse2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    for (;i+16<=count;i+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i));
+        /* byte goes to the high half: v*0x100 */
+        _mm_storeu_si128((__m128i *)(outbuf+i), _mm_unpacklo_epi8(zero,v));
+        _mm_storeu_si128((__m128i *)(outbuf+i+8), _mm_unpackhi_epi8(zero,v));
+    }
+    pcm8_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+TARGET_SSE2
+static void pcm8_unsigned_sse2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    for (;i+16<=count;i+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i));
+        v = _mm_xor_si128(v,bias);
+        _mm_storeu_si128((__m128i *)(outbuf+i), _mm_unpacklo_epi8(zero,v));
+        _mm_storeu_si128((__m128i *)(outbuf+i+8), _mm_unpackhi_epi8(zero,v));
+    }
+    pcm8_unsigned_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+TARGET_SSE2
+static void pcm8_sb_sse2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mag_mask = _mm_set1_epi8(0x7f);
+    for (;i+16<=count;i+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i));
+        /* sign-magnitude to two's complement: (mag ^ sign) - sign */
+        __m128i sign = _mm_cmplt_epi8(v,zero);
+        __m128i mag = _mm_and_si128(v,mag_mask);
+        v = _mm_sub_epi8(_mm_xor_si128(mag,sign),sign);
+        _mm_storeu_si128((__m128i *)(outbuf+i), _mm_unpacklo_epi8(zero,v));
+        _mm_storeu_si128((__m128i *)(outbuf+i+8), _mm_unpackhi_epi8(zero,v));
+    }
+    pcm8_sb_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+TARGET_SSE2
+static void adpcm_nibbles_sse2(int16_t * outbuf, const uint8_t * inbuf, int bytes, int shift) {
+    int i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i high_mask = _mm_set1_epi8((char)0xf0);
+    const __m128i shift_count = _mm_cvtsi32_si128(shift);
+    for (;i+16<=bytes;i+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i));
+        /* both nibbles moved to the top of a byte, then of a word */
+        __m128i lo = _mm_and_si128(_mm_slli_epi16(v,4),high_mask);
+        __m128i hi = _mm_and_si128(v,high_mask);
+        __m128i b0 = _mm_unpacklo_epi8(lo,hi);
+        __m128i b1 = _mm_unpackhi_epi8(lo,hi);
+        _mm_storeu_si128((__m128i *)(outbuf+i*2), _mm_sra_epi16(_mm_unpacklo_epi8(zero,b0),shift_count));
+        _mm_storeu_si128((__m128i *)(outbuf+i*2+8), _mm_sra_epi16(_mm_unpackhi_epi8(zero,b0),shift_count));
+        _mm_storeu_si128((__m128i *)(outbuf+i*2+16), _mm_sra_epi16(_mm_unpacklo_epi8(zero,b1),shift_count));
+        _mm_storeu_si128((__m128i *)(outbuf+i*2+24), _mm_sra_epi16(_mm_unpackhi_epi8(zero,b1),shift_count));
+    }
+    adpcm_nibbles_scalar(outbuf+i*2,inbuf+i,bytes-i,shift);
+}
+
+/* (v*gain)>>14 with 32-bit products, gain is 2.14 */
+TARGET_SSE2
+static __m128i scale_sse2(__m128i v, __m128i gain) {
+    __m128i lo = _mm_mullo_epi16(v,gain);
+    __m128i hi = _mm_mulhi_epi16(v,gain);
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo,hi),14),
+            _mm_srai_epi32(_mm_unpackhi_epi16(lo,hi),14));
+}
+
+TARGET_SSE2
+static void fade_linear_sse2(sample * buf, int channels, int count, int32_t volume, int32_t volume_step) {
+    int i = 0;
+    if (channels == 1 || channels == 2) {
+        int frames = 8/channels; /* per 8 samples */
+        const __m128i step4 = _mm_set1_epi32(volume_step*4);
+        __m128i vol = _mm_setr_epi32(volume,volume+volume_step,volume+volume_step*2,volume+volume_step*3);
+        for (;i+frames<=count;i+=frames) {
+            __m128i gain, v;
+            if (channels == 1) {
+                __m128i vol_next = _mm_add_epi32(vol,step4);
+                gain = _mm_packs_epi32(_mm_srai_epi32(vol,16),_mm_srai_epi32(vol_next,16));
+                vol = _mm_add_epi32(vol_next,step4);
+            }
+            else {
+                gain = _mm_packs_epi32(_mm_srai_epi32(vol,16),_mm_setzero_si128());
+                gain = _mm_unpacklo_epi16(gain,gain);
+                vol = _mm_add_epi32(vol,step4);
+            }
+            v = _mm_loadu_si128((const __m128i *)(buf+i*channels));
+            _mm_storeu_si128((__m128i *)(buf+i*channels), scale_sse2(v,gain));
+        }
+        volume += volume_step*i;
+    }
+    else if (channels >= 4) {
+        /* a frame at a time, with its gain in every lane */
+        for (;i<count;i++) {
+            sample * frame = buf+i*channels;
+            int32_t gain16 = volume >> 16;
+            const __m128i gain = _mm_set1_epi16((int16_t)gain16);
+            int ch = 0;
+            for (;ch+8<=channels;ch+=8) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(frame+ch));
+                _mm_storeu_si128((__m128i *)(frame+ch), scale_sse2(v,gain));
+            }
+            if (ch+4<=channels) {
+                __m128i v = _mm_loadl_epi64((const __m128i *)(frame+ch));
+                _mm_storel_epi64((__m128i *)(frame+ch), scale_sse2(v,gain));
+                ch+=4;
+            }
+            for (;ch<channels;ch++)
+                frame[ch] = (frame[ch]*gain16) >> 14;
+            volume += volume_step;
+        }
+        return;
+    }
+    fade_linear_scalar(buf+i*channels,channels,count-i,volume,volume_step);
+}
+
+TARGET_SSE2
+static void interleave_sse2(sample * outbuf, sample ** inbufs, int channels, int count) {
+    int i = 0;
+    if (channels == 2) {
+        const sample * l = inbufs[0];
+        const sample * r = inbufs[1];
+        for (;i+8<=count;i+=8) {
+            __m128i vl = _mm_loadu_si128((const __m128i *)(l+i));
+            __m128i vr = _mm_loadu_si128((const __m128i *)(r+i));
+            _mm_storeu_si128((__m128i *)(outbuf+i*2), _mm_unpacklo_epi16(vl,vr));
+            _mm_storeu_si128((__m128i *)(outbuf+i*2+8), _mm_unpackhi_epi16(vl,vr));
+        }
+        for (;i<count;i++) {
+            outbuf[i*2] = l[i];
+            outbuf[i*2+1] = r[i];
+        }
+        return;
+    }
+    interleave_scalar(outbuf,inbufs,channels,count);
+}
+
+TARGET_SSE2
+static void deinterleave_sse2(sample ** outbufs, const sample * inbuf, int channels, int count) {
+    int i = 0;
+    if (channels == 2) {
+        sample * l = outbufs[0];
+        sample * r = outbufs[1];
+        for (;i+8<=count;i+=8) {
+            /* each frame is a 32-bit lane, left in the low half */
+            __m128i v0 = _mm_loadu_si128((const __m128i *)(inbuf+i*2));
+            __m128i v1 = _mm_loadu_si128((const __m128i *)(inbuf+i*2+8));
+            __m128i l0 = _mm_srai_epi32(_mm_slli_epi32(v0,16),16);
+            __m128i l1 = _mm_srai_epi32(_mm_slli_epi32(v1,16),16);
+            _mm_storeu_si128((__m128i *)(l+i), _mm_packs_epi32(l0,l1));
+            _mm_storeu_si128((__m128i *)(r+i), _mm_packs_epi32(_mm_srai_epi32(v0,16),_mm_srai_epi32(v1,16)));
+        }
+        for (;i<count;i++) {
+            l[i] = inbuf[i*2];
+            r[i] = inbuf[i*2+1];
+        }
+        return;
+    }
+    deinterleave_scalar(outbufs,inbuf,channels,count);
+}
+
+TARGET_SSE2
+static void to_float_sse2(float * outbuf, const sample * inbuf, int count) {
+    int i = 0;
+    const __m128 scale = _mm_set1_ps(1.0f/32768.0f);
+    for (;i+8<=count;i+=8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v,v),16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v,v),16);
+        _mm_storeu_ps(outbuf+i, _mm_mul_ps(_mm_cvtepi32_ps(lo),scale));
+        _mm_storeu_ps(outbuf+i+4, _mm_mul_ps(_mm_cvtepi32_ps(hi),scale));
+    }
+    to_float_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+/* SSSE3: byte shuffles and sign */
+
+TARGET_SSSE3
+static void pcm16BE_ssse3(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    const __m128i swap = _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+    for (;i+8<=count;i+=8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i*2));
+        _mm_storeu_si128((__m128i *)(outbuf+i), _mm_shuffle_epi8(v,swap));
+    }
+    pcm16BE_scalar(outbuf+i,inbuf+i*2,count-i);
+}
+
+TARGET_SSSE3
+static void pcm8_sb_ssse3(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mag_mask = _mm_set1_epi8(0x7f);
+    for (;i+16<=count;i+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(inbuf+i));
+        v = _mm_sign_epi8(_mm_and_si128(v,mag_mask),v);
+        _mm_storeu_si128((__m128i *)(outbuf+i), _mm_unpacklo_epi8(zero,v));
+        _mm_storeu_si128((__m128i *)(outbuf+i+8), _mm_unpackhi_epi8(zero,v));
+    }
+    pcm8_sb_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+#ifdef KERNELS_AVX2
+/* AVX2: 16 samples per step (32 for 8-bit) */
+
+TARGET_AVX2
+static void pcm16LE_avx2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    for (;i+16<=count;i+=16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(inbuf+i*2));
+        _mm256_storeu_si256((__m256i *)(outbuf+i), v);
+    }
+    pcm16LE_sse2(outbuf+i,inbuf+i*2,count-i);
+}
+
+TARGET_AVX2
+static void pcm16BE_avx2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    const __m256i swap = _mm256_setr_epi8(
+            1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14,
+            1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+    for (;i+16<=count;i+=16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(inbuf+i*2));
+        _mm256_storeu_si256((__m256i *)(outbuf+i), _mm256_shuffle_epi8(v,swap));
+    }
+    pcm16BE_ssse3(outbuf+i,inbuf+i*2,count-i);
+}
+
+TARGET_AVX2
+static void pcm8_avx2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    for (;i+16<=count;i+=16) {
+        __m256i v = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(inbuf+i)));
+        _mm256_storeu_si256((__m256i *)(outbuf+i), _mm256_slli_epi16(v,8));
+    }
+    pcm8_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+TARGET_AVX2
+static void pcm8_unsigned_avx2(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    const __m256i bias = _mm256_set1_epi16((short)0x8000);
+    for (;i+16<=count;i+=16) {
+        __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(inbuf+i)));
+        _mm256_storeu_si256((__m256i *)(outbuf+i), _mm256_xor_si256(_mm256_slli_epi16(v,8),bias));
+    }
+    pcm8_unsigned_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+TARGET_AVX2
+static void interleave_avx2(sample * outbuf, sample ** inbufs, int channels, int count) {
+    int i = 0;
+    if (channels == 2) {
+        const sample * l = inbufs[0];
+        const sample * r = inbufs[1];
+        for (;i+16<=count;i+=16) {
+            __m256i vl = _mm256_loadu_si256((const __m256i *)(l+i));
+            __m256i vr = _mm256_loadu_si256((const __m256i *)(r+i));
+            /* unpacks work per 128-bit lane, put the halves back in order */
+            __m256i lo = _mm256_unpacklo_epi16(vl,vr);
+            __m256i hi = _mm256_unpackhi_epi16(vl,vr);
+            _mm256_storeu_si256((__m256i *)(outbuf+i*2), _mm256_permute2x128_si256(lo,hi,0x20));
+            _mm256_storeu_si256((__m256i *)(outbuf+i*2+16), _mm256_permute2x128_si256(lo,hi,0x31));
+        }
+        for (;i<count;i++) {
+            outbuf[i*2] = l[i];
+            outbuf[i*2+1] = r[i];
+        }
+        return;
+    }
+    interleave_scalar(outbuf,inbufs,channels,count);
+}
+
+TARGET_AVX2
+static void to_float_avx2(float * outbuf, const sample * inbuf, int count) {
+    int i = 0;
+    const __m256 scale = _mm256_set1_ps(1.0f/32768.0f);
+    for (;i+8<=count;i+=8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(inbuf+i)));
+        _mm256_storeu_ps(outbuf+i, _mm256_mul_ps(_mm256_cvtepi32_ps(v),scale));
+    }
+    to_float_scalar(outbuf+i,inbuf+i,count-i);
+}
+#endif /* KERNELS_AVX2 */
+
+static cpu_level_t detect_cpu_level(void) {
+    unsigned int eax, ebx, ecx, edx;
+    int has_avx = 0;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info,0);
+    if (info[0] < 1) return cpu_level_scalar;
+    eax = info[0];
+    __cpuid(info,1);
+    ecx = info[2]; edx = info[3];
+#else
+    if (!__get_cpuid(1,&eax,&ebx,&ecx,&edx)) return cpu_level_scalar;
+    eax = __get_cpuid_max(0,NULL);
+#endif
+    if (!((edx >> 26) & 1)) return cpu_level_scalar;
+    if (!((ecx >> 9) & 1)) return cpu_level_sse2;
+
+#ifdef KERNELS_AVX2
+    /* AVX also needs the OS to save the YMM registers (OSXSAVE + XCR0) */
+    if (((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+        uint32_t xcr0;
+#if defined(_MSC_VER)
+        xcr0 = (uint32_t)_xgetbv(0);
+#else
+        uint32_t xcr0_high;
+        __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+#endif
+        has_avx = (xcr0 & 6) == 6;
+    }
+    if (has_avx && eax >= 7) {
+#if defined(_MSC_VER)
+        __cpuidex(info,7,0);
+        ebx = info[1];
+#else
+        __cpuid_count(7,0,eax,ebx,ecx,edx);
+#endif
+        if ((ebx >> 5) & 1) return cpu_level_avx2;
+    }
+#endif
+    return cpu_level_ssse3;
+}
+#endif /* KERNELS_X86 */
+
+
+#ifdef KERNELS_NEON
+/* NEON: 8 samples per step (16 for 8-bit) */
+
+static void pcm16BE_neon(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    for (;i+8<=count;i+=8) {
+        uint8x16_t v = vld1q_u8(inbuf+i*2);
+        vst1q_s16(outbuf+i, vreinterpretq_s16_u8(vrev16q_u8(v)));
+    }
+    pcm16BE_scalar(outbuf+i,inbuf+i*2,count-i);
+}
+
+static void pcm8_neon(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    for (;i+16<=count;i+=16) {
+        int8x16_t v = vld1q_s8((const int8_t *)(inbuf+i));
+        vst1q_s16(outbuf+i, vshll_n_s8(vget_low_s8(v),8));
+        vst1q_s16(outbuf+i+8, vshll_n_s8(vget_high_s8(v),8));
+    }
+    pcm8_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+static void pcm8_unsigned_neon(sample * outbuf, const uint8_t * inbuf, int count) {
+    int i = 0;
+    const uint8x16_t bias = vdupq_n_u8(0x80);
+    for (;i+16<=count;i+=16) {
+        int8x16_t v = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(inbuf+i),bias));
+        vst1q_s16(outbuf+i, vshll_n_s8(vget_low_s8(v),8));
+        vst1q_s16(outbuf+i+8, vshll_n_s8(vget_high_s8(v),8));
+    }
+    pcm8_unsigned_scalar(outbuf+i,inbuf+i,count-i);
+}
+
+static void fade_linear_neon(sample * buf, int channels, int count, int32_t volume, int32_t volume_step) {
+    int i;
+    if (channels < 4) {
+        fade_linear_scalar(buf,channels,count,volume,volume_step);
+        return;
+    }
+    /* a frame at a time, with its gain in every lane */
+    for (i=0;i<count;i++) {
+        sample * frame = buf+i*channels;
+        int32_t gain16 = volume >> 16;
+        const int16x4_t gain = vdup_n_s16((int16_t)gain16);
+        int ch = 0;
+        for (;ch+8<=channels;ch+=8) {
+            int16x8_t v = vld1q_s16(frame+ch);
+            vst1q_s16(frame+ch, vcombine_s16(
+                    vqshrn_n_s32(vmull_s16(vget_low_s16(v),gain),14),
+                    vqshrn_n_s32(vmull_s16(vget_high_s16(v),gain),14)));
+        }
+        if (ch+4<=channels) {
+            vst1_s16(frame+ch, vqshrn_n_s32(vmull_s16(vld1_s16(frame+ch),gain),14));
+            ch+=4;
+        }
+        for (;ch<channels;ch++)
+            frame[ch] = (frame[ch]*gain16) >> 14;
+        volume += volume_step;
+    }
+}
+
+static void interleave_neon(sample * outbuf, sample ** inbufs, int channels, int count) {
+    int i = 0;
+    if (channels == 2) {
+        for (;i+8<=count;i+=8) {
+            int16x8x2_t v;
+            v.val[0] = vld1q_s16(inbufs[0]+i);
+            v.val[1] = vld1q_s16(inbufs[1]+i);
+            vst2q_s16(outbuf+i*2, v);
+        }
+        for (;i<count;i++) {
+            outbuf[i*2] = inbufs[0][i];
+            outbuf[i*2+1] = inbufs[1][i];
+        }
+        return;
+    }
+    interleave_scalar(outbuf,inbufs,channels,count);
+}
+
+static void deinterleave_neon(sample ** outbufs, const sample * inbuf, int channels, int count) {
+    int i = 0;
+    if (channels == 2) {
+        for (;i+8<=count;i+=8) {
+            int16x8x2_t v = vld2q_s16(inbuf+i*2);
+            vst1q_s16(outbufs[0]+i, v.val[0]);
+            vst1q_s16(outbufs[1]+i, v.val[1]);
+        }
+        for (;i<count;i++) {
+            outbufs[0][i] = inbuf[i*2];
+            outbufs[1][i] = inbuf[i*2+1];
+        }
+        return;
+    }
+    deinterleave_scalar(outbufs,inbuf,channels,count);
+}
+
+static void to_float_neon(float * outbuf, const sample * inbuf, int count) {
+    int i = 0;
+    for (;i+8<=count;i+=8) {
+        int16x8_t v = vld1q_s16(inbuf+i);
+        vst1q_f32(outbuf+i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))),1.0f/32768.0f));
+        vst1q_f32(outbuf+i+4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))),1.0f/32768.0f));
+    }
+    to_float_scalar(outbuf+i,inbuf+i,count-i);
+}
+#endif /* KERNELS_NEON */
+
+
+static const vgmstream_kernels kernels_scalar = {
+    pcm16LE_scalar,
+    pcm16BE_scalar,
+    pcm8_scalar,
+    pcm8_unsigned_scalar,
+    pcm8_sb_scalar,
+    adpcm_nibbles_scalar,
+    fade_linear_scalar,
+    interleave_scalar,
+    deinterleave_scalar,
+    to_float_scalar,
+};
+
+static const char * const cpu_level_names[] = {
+    "scalar",
+    "sse2",
+    "ssse3",
+    "avx2",
+    "neon",
+};
+
+static vgmstream_kernels kernels_selected;
+static cpu_level_t cpu_level = cpu_level_scalar;
+
+/* start from the scalar kernels and replace the ones each level has */
+static void setup_kernels(vgmstream_kernels * kernels, cpu_level_t level) {
+    *kernels = kernels_scalar;
+
+#ifdef KERNELS_X86
+    if (level >= cpu_level_sse2 && level <= cpu_level_avx2) {
+        kernels->pcm16LE = pcm16LE_sse2;
+        kernels->pcm16BE = pcm16BE_sse2;
+        kernels->pcm8 = pcm8_sse2;
+        kernels->pcm8_unsigned = pcm8_unsigned_sse2;
+        kernels->pcm8_sb = pcm8_sb_sse2;
+        kernels->adpcm_nibbles = adpcm_nibbles_sse2;
+        kernels->fade_linear = fade_linear_sse2;
+        kernels->interleave = interleave_sse2;
+        kernels->deinterleave = deinterleave_sse2;
+        kernels->to_float = to_float_sse2;
+    }
+    if (level >= cpu_level_ssse3 && level <= cpu_level_avx2) {
+        kernels->pcm16BE = pcm16BE_ssse3;
+        kernels->pcm8_sb = pcm8_sb_ssse3;
+    }
+#ifdef KERNELS_AVX2
+    if (level == cpu_level_avx2) {
+        kernels->pcm16LE = pcm16LE_avx2;
+        kernels->pcm16BE = pcm16BE_avx2;
+        kernels->pcm8 = pcm8_avx2;
+        kernels->pcm8_unsigned = pcm8_unsigned_avx2;
+        kernels->interleave = interleave_avx2;
+        kernels->to_float = to_float_avx2;
+    }
+#endif
+#endif
+
+#ifdef KERNELS_NEON
+    if (level == cpu_level_neon) {
+        kernels->pcm16BE = pcm16BE_neon;
+        kernels->pcm8 = pcm8_neon;
+        kernels->pcm8_unsigned = pcm8_unsigned_neon;
+        kernels->fade_linear = fade_linear_neon;
+        kernels->interleave = interleave_neon;
+        kernels->deinterleave = deinterleave_neon;
+        kernels->to_float = to_float_neon;
+    }
+#endif
+}
+
+static void select_kernels(void) {
+    cpu_level_t level = cpu_level_scalar;
+    const char * forced;
+    int i;
+
+#if defined(KERNELS_X86)
+    level = detect_cpu_level();
+#elif defined(KERNELS_NEON)
+    level = cpu_level_neon;
+#endif
+
+    /* only lower levels of the same family can be forced */
+    forced = getenv("VGMSTREAM_CPU");
+    if (forced) {
+        for (i=cpu_level_scalar;i<=cpu_level_neon;i++) {
+            if (strcmp(forced,cpu_level_names[i])) continue;
+
+            if (i == cpu_level_scalar ||
+                    (level != cpu_level_neon && i <= (int)level) ||
+                    (level == cpu_level_neon && i == cpu_level_neon))
+                level = i;
+            break;
+        }
+    }
+
+    setup_kernels(&kernels_selected,level);
+    cpu_level = level;
+}
+
+/* other threads may be calling through the table, it's only written once
+ * and they wait until it is */
+#ifdef WIN32
+static volatile LONG init_state = 0;
+
+void init_kernels(void) {
+    /* 0: not started, 1: starting, 2: done */
+    if (InterlockedCompareExchange(&init_state,1,0) == 0) {
+        select_kernels();
+        InterlockedExchange(&init_state,2);
+    }
+    while (init_state != 2)
+        Sleep(0);
+}
+#else
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+void init_kernels(void) {
+    pthread_once(&init_once,select_kernels);
+}
+#endif
+
+const vgmstream_kernels * get_kernels(void) {
+    init_kernels();
+    return &kernels_selected;
+}
+
+cpu_level_t get_cpu_level(void) {
+    init_kernels();
+    return cpu_level;
+}
+
+const char * get_cpu_level_name(cpu_level_t level) {
+    if (level < cpu_level_scalar || level > cpu_level_neon)
+        return "unknown";
+    return cpu_level_names[level];
+}
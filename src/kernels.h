@@ -0,0 +1,53 @@
+/*
+ * kernels.h - sample loops with versions for different CPU features
+ */
+
+#include "streamtypes.h"
+
+#ifndef _KERNELS_H
+#define _KERNELS_H
+
+/* x86 levels include all the lower ones */
+typedef enum {
+    cpu_level_scalar,
+    cpu_level_sse2,
+    cpu_level_ssse3,
+    cpu_level_avx2,
+    cpu_level_neon
+} cpu_level_t;
+
+typedef struct {
+    /* PCM, convert count contiguous samples */
+    void (*pcm16LE)(sample * outbuf, const uint8_t * inbuf, int count);
+    void (*pcm16BE)(sample * outbuf, const uint8_t * inbuf, int count);
+    void (*pcm8)(sample * outbuf, const uint8_t * inbuf, int count);
+    void (*pcm8_unsigned)(sample * outbuf, const uint8_t * inbuf, int count);
+    void (*pcm8_sb)(sample * outbuf, const uint8_t * inbuf, int count); /* sign-magnitude */
+
+    /* ADPCM, expand bytes to two signed nibbles each, low nibble first,
+     * as (nibble<<12)>>shift */
+    void (*adpcm_nibbles)(int16_t * outbuf, const uint8_t * inbuf, int bytes, int shift);
+
+    /* fade, scale count frames by a linear volume ramp. volume is 2.30 fixed
+     * point (1<<30 is unity) and volume_step is added to it every frame. */
+    void (*fade_linear)(sample * buf, int channels, int count, int32_t volume, int32_t volume_step);
+
+    /* conversion */
+    void (*interleave)(sample * outbuf, sample ** inbufs, int channels, int count);
+    void (*deinterleave)(sample ** outbufs, const sample * inbuf, int channels, int count);
+    void (*to_float)(float * outbuf, const sample * inbuf, int count);
+} vgmstream_kernels;
+
+/* Detect the CPU and pick the kernels, the VGMSTREAM_CPU environment variable
+ * (scalar, sse2, ssse3, avx2, neon) forces a lower level. Called by
+ * init_vgmstream, safe to call more than once. */
+void init_kernels(void);
+
+/* kernels for the selected level, initializing them if needed */
+const vgmstream_kernels * get_kernels(void);
+
+cpu_level_t get_cpu_level(void);
+
+const char * get_cpu_level_name(cpu_level_t level);
+
+#endif
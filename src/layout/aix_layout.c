@@ -1,8 +1,39 @@
 #include "layout.h"
 #include "../vgmstream.h"
 #include "../coding/coding.h"
+#include "../kernels.h"
+#include "../workpool.h"
+
+/* render one stream of the current segment to its channels' buffers, the
+ * streams read their own files so they can go on different threads */
+static void render_aix_stream(void * arg, int stream) {
+    aix_codec_data *data = arg;
+    VGMSTREAM **adxs = &data->adxs[data->current_segment*data->stream_count];
+    int first_channel = 0;
+    int i;
+
+    for (i = 0; i < stream; i++)
+        first_channel += adxs[i]->channels;
+
+    render_vgmstream_planar(&data->channel_buffers[first_channel],data->samples_to_do,adxs[stream]);
+}
+
+/* make the channel buffers hold samples, buffer_samples stays as is if
+ * there is no memory for that */
+static void grow_channel_buffers(aix_codec_data *data, int channels, int32_t samples) {
+    int i;
+
+    for (i = 0; i < channels; i++)
+    {
+        sample * grown = realloc(data->channel_buffers[i],samples*sizeof(sample));
+        if (!grown) return;
+        data->channel_buffers[i] = grown;
+    }
+    data->buffer_samples = samples;
+}
 
 void render_vgmstream_aix(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    const vgmstream_kernels * kernels = get_kernels();
     int samples_written=0;
     aix_codec_data *data = vgmstream->codec_data;
 
@@ -10,7 +41,7 @@ void render_vgmstream_aix(sample * buffer, int32_t sample_count, VGMSTREAM * vgm
         int samples_to_do;
         int samples_this_block = data->sample_counts[data->current_segment];
         int current_stream;
-        int channels_sofar = 0;
+        workpool * pool = NULL;
 
         if (vgmstream->loop_flag && vgmstream_do_loop(vgmstream)) {
             data->current_segment = 1;
@@ -62,28 +93,19 @@ void render_vgmstream_aix(sample * buffer, int32_t sample_count, VGMSTREAM * vgm
         }
 
         /*printf("decode %d samples file %d\n",samples_to_do,data->current_file);*/
-        if (samples_to_do > AIX_BUFFER_SIZE/2)
-        {
-            samples_to_do = AIX_BUFFER_SIZE/2;
-        }
-
-        for (current_stream = 0; current_stream < data->stream_count; current_stream++)
-        {
-            int i,j;
-            VGMSTREAM *adx = data->adxs[data->current_segment*data->stream_count+current_stream];
+        if (samples_to_do > data->buffer_samples)
+            grow_channel_buffers(data,vgmstream->channels,samples_to_do);
+        if (samples_to_do > data->buffer_samples)
+            samples_to_do = data->buffer_samples;
 
-            render_vgmstream(data->buffer,samples_to_do,adx);
+        if (vgmstream_parallel_wanted(samples_to_do*vgmstream->channels))
+            pool = get_workpool();
 
-            for (i = 0; i < samples_to_do; i++)
-            {
-                for (j = 0; j < adx->channels; j++)
-                {
-                    buffer[(i+samples_written)*vgmstream->channels+channels_sofar+j] = data->buffer[i*adx->channels+j];
-                }
-            }
+        data->samples_to_do = samples_to_do;
+        workpool_run(pool,render_aix_stream,data,data->stream_count);
 
-            channels_sofar += adx->channels;
-        }
+        kernels->interleave(buffer+samples_written*vgmstream->channels,
+                data->channel_buffers,vgmstream->channels,samples_to_do);
 
         samples_written += samples_to_do;
         vgmstream->current_sample += samples_to_do;
@@ -48,91 +48,9 @@ void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM *
         vgmstream->samples_into_block+=samples_to_do;
 
         if (vgmstream->samples_into_block==samples_this_block) {
-            switch (vgmstream->layout_type) {
-                case layout_ast_blocked:
-                    ast_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-				case layout_mxch_blocked:
-                    mxch_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_halpst_blocked:
-                    if (vgmstream->next_block_offset>=0)
-                        halpst_block_update(vgmstream->next_block_offset,vgmstream);
-                    else
-                        vgmstream->current_block_offset=-1;
-                    break;
-				case layout_xa_blocked:
-					xa_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_ea_blocked:
-					ea_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_eacs_blocked:
-					eacs_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_caf_blocked:
-					caf_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-                case layout_wsi_blocked:
-                    wsi_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_str_snds_blocked:
-                    str_snds_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_ws_aud_blocked:
-                    ws_aud_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_matx_blocked:
-                    matx_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_de2_blocked:
-                    de2_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_emff_ps2_blocked:
-                    emff_ps2_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_emff_ngc_blocked:
-                    emff_ngc_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_gsb_blocked:
-                    gsb_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_vs_blocked:
-                    vs_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-				case layout_xvas_blocked:
-					xvas_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_thp_blocked:
-					thp_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_filp_blocked:
-					filp_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_ivaud_blocked:
-					ivaud_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_psx_mgav_blocked:
-					psx_mgav_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_ps2_adm_blocked:
-					ps2_adm_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_dsp_bdsp_blocked:
-					dsp_bdsp_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_tra_blocked:
-					tra_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_ps2_iab_blocked:
-					ps2_iab_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				case layout_ps2_strlr_blocked:
-					ps2_strlr_block_update(vgmstream->next_block_offset,vgmstream);
-					break;
-				default:
-                    break;
-            }
+            /* set up by setup_vgmstream_layout for the current layout_type */
+            if (vgmstream->block_update)
+                vgmstream->block_update(vgmstream->next_block_offset,vgmstream);
 
             /* for VBR these may change */
             frame_size = get_vgmstream_frame_size(vgmstream);
@@ -4,6 +4,13 @@
 /* set up for the block at the given offset */
 void halpst_block_update(off_t block_offset, VGMSTREAM * vgmstream) {
     int i;
+
+    /* a negative offset marks the last block, we've run off the end */
+    if (block_offset < 0) {
+        vgmstream->current_block_offset = -1;
+        return;
+    }
+
     vgmstream->current_block_offset = block_offset;
     vgmstream->current_block_size = read_32bitBE(
             vgmstream->current_block_offset,
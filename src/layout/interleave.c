@@ -31,6 +31,16 @@ void render_vgmstream_interleave(sample * buffer, int32_t sample_count, VGMSTREA
             continue;
         }
 
+        /* a thread for each channel, when the stream decodes them apart */
+        if (vgmstream->layout_type == layout_interleave) {
+            samples_to_do = decode_vgmstream_span(vgmstream, samples_written, sample_count-samples_written, buffer,
+                    samples_this_block, vgmstream->interleave_block_size*vgmstream->channels);
+            if (samples_to_do) {
+                samples_written += samples_to_do;
+                continue;
+            }
+        }
+
         samples_to_do = vgmstream_samples_to_do(samples_this_block, samples_per_frame, vgmstream);
         /*printf("vgmstream_samples_to_do(samples_this_block=%d,samples_per_frame=%d,vgmstream) returns %d\n",samples_this_block,samples_per_frame,samples_to_do);*/
 
@@ -0,0 +1,39 @@
+#include "layout.h"
+#include "../vgmstream.h"
+#include "../coding/coding.h"
+
+/* for PCM where the interleave is a single sample, so the file is really
+ * sample-interleaved: instead of going through one block (one sample) at a
+ * time, decode as many samples as the loop points allow straight from the
+ * file, all channels at once */
+
+void render_vgmstream_interleave_sample(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    int samples_written=0;
+    off_t frame_step = vgmstream->interleave_block_size*vgmstream->channels;
+
+    while (samples_written<sample_count) {
+        int samples_to_do;
+        int chan;
+
+        if (vgmstream->loop_flag && vgmstream_do_loop(vgmstream)) {
+            continue;
+        }
+
+        /* there are no blocks to stop at, only the loop points */
+        samples_to_do = vgmstream_samples_to_do(sample_count-samples_written, 1, vgmstream);
+
+        if (!decode_pcm_int_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                    0,samples_to_do)) {
+            /* channels aren't where they should be any more, shouldn't happen */
+            render_vgmstream_interleave(buffer+samples_written*vgmstream->channels,
+                    sample_count-samples_written,vgmstream);
+            return;
+        }
+
+        samples_written += samples_to_do;
+        vgmstream->current_sample += samples_to_do;
+
+        for (chan=0;chan<vgmstream->channels;chan++)
+            vgmstream->ch[chan].offset+=frame_step*samples_to_do;
+    }
+}
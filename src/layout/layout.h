@@ -52,6 +52,8 @@ void render_vgmstream_nolayout(sample * buffer, int32_t sample_count, VGMSTREAM
 
 void render_vgmstream_interleave_byte(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 
+void render_vgmstream_interleave_sample(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
 void render_vgmstream_mus_acm(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 
 void render_vgmstream_aix(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
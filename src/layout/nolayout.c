@@ -14,6 +14,13 @@ void render_vgmstream_nolayout(sample * buffer, int32_t sample_count, VGMSTREAM
             continue;
         }
 
+        /* a thread for each channel, when the stream decodes them apart */
+        samples_to_do = decode_vgmstream_span(vgmstream, samples_written, sample_count-samples_written, buffer, 0, 0);
+        if (samples_to_do) {
+            samples_written += samples_to_do;
+            continue;
+        }
+
         samples_to_do = vgmstream_samples_to_do(samples_this_block, samples_per_frame, vgmstream);
 
         if (samples_written+samples_to_do > sample_count)
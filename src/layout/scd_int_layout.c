@@ -1,38 +1,60 @@
 #include "layout.h"
 #include "../vgmstream.h"
+#include "../kernels.h"
+#include "../workpool.h"
 
 /* TODO: currently only properly handles mono substreams */
 /* TODO: there must be a reasonable way to respect the loop settings, as is
    the substreams are in their own little world */
 
-#define INTERLEAVE_BUF_SIZE 512
+/* the substreams read their own files so they can go on different threads */
+static void render_scd_substream(void * arg, int substream) {
+    scd_int_codec_data *data = arg;
+
+    render_vgmstream(data->buffers[substream],
+            data->samples_to_do, data->substreams[substream]);
+}
+
+/* make the substream buffers hold samples, buffer_samples stays as is if
+ * there is no memory for that */
+static void grow_substream_buffers(scd_int_codec_data *data, int32_t samples) {
+    int c;
+
+    for (c=0; c < data->substream_count; c++)
+    {
+        sample * grown = realloc(data->buffers[c],samples*sizeof(sample));
+        if (!grown) return;
+        data->buffers[c] = grown;
+    }
+    data->buffer_samples = samples;
+}
+
 void render_vgmstream_scd_int(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
-    sample interleave_buf[INTERLEAVE_BUF_SIZE];
+    const vgmstream_kernels * kernels = get_kernels();
     int32_t samples_done = 0;
     scd_int_codec_data *data = vgmstream->codec_data;
 
+    if (sample_count > data->buffer_samples)
+        grow_substream_buffers(data, sample_count);
+
     while (samples_done < sample_count)
     {
-        int32_t samples_to_do = INTERLEAVE_BUF_SIZE;
-        int c;
+        int32_t samples_to_do = data->buffer_samples;
+        workpool * pool = NULL;
+
         if (samples_to_do > sample_count - samples_done)
             samples_to_do = sample_count - samples_done;
 
-        for (c=0; c < data->substream_count; c++)
-        {
-            int32_t i;
+        if (vgmstream_parallel_wanted(samples_to_do*data->substream_count))
+            pool = get_workpool();
 
-            render_vgmstream(interleave_buf,
-                    samples_to_do, data->substreams[c]);
+        data->samples_to_do = samples_to_do;
+        workpool_run(pool, render_scd_substream, data, data->substream_count);
 
-            for (i=0; i < samples_to_do; i++)
-            {
-                buffer[(samples_done+i)*data->substream_count + c] = interleave_buf[i];
-            }
-        }
+        kernels->interleave(buffer + samples_done*data->substream_count,
+                data->buffers, data->substream_count, samples_to_do);
 
         samples_done += samples_to_do;
 
     }
 }
-
@@ -9,7 +9,16 @@ void xa_block_update(off_t block_offset, VGMSTREAM * vgmstream) {
 	int8_t currentChannel=0;
 	int8_t subAudio=0;
 	
-	init_get_high_nibble(vgmstream);
+	/* the group played through, its history goes on to the next one */
+	if (vgmstream->xa_group_decoded) {
+		for (i=0;i<vgmstream->channels;i++) {
+			vgmstream->ch[i].adpcm_history1_32 = vgmstream->xa_group_history[i][0];
+			vgmstream->ch[i].adpcm_history2_32 = vgmstream->xa_group_history[i][1];
+		}
+	}
+
+	/* new sound group, decoded on first use */
+	vgmstream->xa_group_decoded=0;
 
 	if(vgmstream->samples_into_block!=0)
 		// don't change this variable in the init process
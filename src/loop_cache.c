@@ -0,0 +1,210 @@
+#include <stdlib.h>
+#include <string.h>
+#include "loop_cache.h"
+
+void free_loop_cache(loop_cache_data * cache) {
+    if (!cache) return;
+
+    free(cache->samples);
+    free(cache->entry_history);
+    free(cache);
+}
+
+void reset_loop_cache(loop_cache_data * cache) {
+    if (!cache) return;
+
+    cache->recording = 0;
+    cache->replaying = 0;
+}
+
+static int loop_cache_usable(loop_cache_data * cache, VGMSTREAM * vgmstream) {
+    return cache->samples && vgmstream->loop_flag &&
+        vgmstream->loop_start_sample == cache->loop_start_sample &&
+        vgmstream->loop_end_sample == cache->loop_end_sample;
+}
+
+/* Where the history the pass after this loop end starts with is:
+ * vgmstream_do_loop takes it from the channels for some codecs, otherwise
+ * loop_ch keeps the one from the loop start (and other codecs only have the
+ * position to go on, so their passes are always the same). */
+static VGMSTREAMCHANNEL * entry_channel(VGMSTREAM * vgmstream, int chan) {
+    return vgmstream_loop_keeps_history(vgmstream) ?
+        &vgmstream->ch[chan] : &vgmstream->loop_ch[chan];
+}
+
+static void save_entry(loop_cache_data * cache, VGMSTREAM * vgmstream) {
+    int chan;
+
+    for (chan=0;chan<vgmstream->channels;chan++) {
+        VGMSTREAMCHANNEL * ch = entry_channel(vgmstream,chan);
+
+        cache->entry_history[chan*2+0] = ch->adpcm_history1_32;
+        cache->entry_history[chan*2+1] = ch->adpcm_history2_32;
+    }
+}
+
+static int same_entry(loop_cache_data * cache, VGMSTREAM * vgmstream) {
+    int chan;
+
+    for (chan=0;chan<vgmstream->channels;chan++) {
+        VGMSTREAMCHANNEL * ch = entry_channel(vgmstream,chan);
+
+        if (cache->entry_history[chan*2+0] != ch->adpcm_history1_32 ||
+                cache->entry_history[chan*2+1] != ch->adpcm_history2_32)
+            return 0;
+    }
+    return 1;
+}
+
+void leave_loop_cache_replay(loop_cache_data * cache, VGMSTREAM * vgmstream) {
+    int32_t position = vgmstream->current_sample;
+    int loop_flag = vgmstream->loop_flag;
+    int32_t loop_start_sample = vgmstream->loop_start_sample;
+    int32_t loop_end_sample = vgmstream->loop_end_sample;
+    sample * buffer;
+
+    cache->replaying = 0;
+    vgmstream->current_sample = cache->loop_end_sample;
+    if (position == cache->loop_end_sample)
+        return;
+
+    buffer = malloc(0x1000*vgmstream->channels*sizeof(sample));
+    if (!buffer) return;
+
+    /* the first render does the loop, as it was when the pass was recorded */
+    vgmstream->loop_flag = 1;
+    vgmstream->loop_start_sample = cache->loop_start_sample;
+    vgmstream->loop_end_sample = cache->loop_end_sample;
+
+    position -= cache->loop_start_sample;
+    while (position > 0) {
+        int32_t count = position > 0x1000 ? 0x1000 : position;
+
+        vgmstream->layout_render(buffer,count,vgmstream);
+        position -= count;
+    }
+    free(buffer);
+
+    vgmstream->loop_flag = loop_flag;
+    vgmstream->loop_start_sample = loop_start_sample;
+    vgmstream->loop_end_sample = loop_end_sample;
+}
+
+int vgmstream_set_loop_cache(VGMSTREAM * vgmstream, size_t max_bytes) {
+    loop_cache_data * cache = vgmstream->loop_cache;
+    int32_t loop_samples = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+
+    if (cache) {
+        if (cache->replaying)
+            leave_loop_cache_replay(cache,vgmstream);
+        free_loop_cache(cache);
+        vgmstream->loop_cache = NULL;
+    }
+
+    if (!vgmstream->loop_flag || loop_samples <= 0 || max_bytes == 0)
+        return 0;
+    if ((size_t)loop_samples > max_bytes / (vgmstream->channels*sizeof(sample)))
+        return 0;
+
+    cache = calloc(1,sizeof(loop_cache_data));
+    if (!cache) goto fail;
+    cache->loop_start_sample = vgmstream->loop_start_sample;
+    cache->loop_end_sample = vgmstream->loop_end_sample;
+
+    cache->samples = malloc((size_t)loop_samples*vgmstream->channels*sizeof(sample));
+    if (!cache->samples) goto fail;
+    cache->entry_history = malloc(2*vgmstream->channels*sizeof(int32_t));
+    if (!cache->entry_history) goto fail;
+
+    vgmstream->loop_cache = cache;
+    return 1;
+
+fail:
+    free_loop_cache(cache);
+    return 0;
+}
+
+void render_vgmstream_loop_cached(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    loop_cache_data * cache = vgmstream->loop_cache;
+    int32_t loop_samples = cache->loop_end_sample - cache->loop_start_sample;
+    int channels = vgmstream->channels;
+
+    while (sample_count > 0) {
+        int32_t position, samples_to_do;
+
+        if (cache->replaying) {
+            position = vgmstream->current_sample - cache->loop_start_sample;
+
+            /* a replayed pass is always finished, even if the loop was
+             * changed in the middle of it */
+            if (position == loop_samples) {
+                if (!loop_cache_usable(cache,vgmstream)) {
+                    /* the decoder is here already */
+                    cache->replaying = 0;
+                    continue;
+                }
+                position = 0;
+            }
+
+            samples_to_do = loop_samples - position;
+            if (samples_to_do > sample_count) samples_to_do = sample_count;
+
+            memcpy(buffer,cache->samples+position*channels,samples_to_do*channels*sizeof(sample));
+            vgmstream->current_sample = cache->loop_start_sample + position + samples_to_do;
+
+            buffer += samples_to_do*channels;
+            sample_count -= samples_to_do;
+            continue;
+        }
+
+        if (!loop_cache_usable(cache,vgmstream) ||
+                vgmstream->current_sample > cache->loop_end_sample) {
+            cache->recording = 0;
+            vgmstream->layout_render(buffer,sample_count,vgmstream);
+            return;
+        }
+
+        if (vgmstream->current_sample == cache->loop_end_sample) {
+            /* the loop is done on the next render */
+            if (cache->recording) {
+                cache->recording = 0;
+                if (same_entry(cache,vgmstream)) {
+                    cache->complete = 1;
+                }
+                else if (++cache->attempts == LOOP_CACHE_ATTEMPTS) {
+                    /* the passes don't settle, stop trying */
+                    free(cache->samples);
+                    cache->samples = NULL;
+                    continue;
+                }
+            }
+
+            if (cache->complete && same_entry(cache,vgmstream)) {
+                cache->replaying = 1;
+                continue;
+            }
+
+            if (!cache->complete) {
+                save_entry(cache,vgmstream);
+                cache->recording = 1;
+            }
+
+            position = 0;
+            samples_to_do = loop_samples;
+        }
+        else {
+            /* up to the loop end, not past it */
+            position = vgmstream->current_sample - cache->loop_start_sample;
+            samples_to_do = cache->loop_end_sample - vgmstream->current_sample;
+        }
+        if (samples_to_do > sample_count) samples_to_do = sample_count;
+
+        vgmstream->layout_render(buffer,samples_to_do,vgmstream);
+
+        if (cache->recording)
+            memcpy(cache->samples+position*channels,buffer,samples_to_do*channels*sizeof(sample));
+
+        buffer += samples_to_do*channels;
+        sample_count -= samples_to_do;
+    }
+}
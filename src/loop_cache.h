@@ -0,0 +1,46 @@
+/*
+ * loop_cache.h - decoded loop kept in memory for the later passes through it
+ */
+
+#ifndef _LOOP_CACHE_H
+#define _LOOP_CACHE_H
+
+#include "vgmstream.h"
+
+/* passes recorded before giving up on finding one that the next repeats */
+#define LOOP_CACHE_ATTEMPTS 8
+
+/* A pass through the loop is recorded as it is decoded, starting at a loop
+ * end (the first pass may decode differently, from the stream start). When
+ * the next pass starts like the recorded one did, they decode the same, and
+ * the later passes are copied from memory instead. While replaying, the
+ * decoder stays at the loop end of the recorded pass, which is where every
+ * replayed pass ends too. */
+typedef struct loop_cache_data {
+    /* loop the samples are for, the caller may change it after */
+    int32_t loop_start_sample;
+    int32_t loop_end_sample;
+
+    sample * samples;           /* a pass, (loop_end-loop_start)*channels */
+    int32_t * entry_history;    /* adpcm history 1 and 2 of each channel the
+                                   recorded pass started with */
+
+    int recording;              /* the pass being decoded goes to samples */
+    int complete;               /* samples hold a pass the next one repeats */
+    int replaying;              /* playing from samples, not decoding */
+    int attempts;               /* passes recorded that the next didn't repeat */
+} loop_cache_data;
+
+void free_loop_cache(loop_cache_data * cache);
+
+/* The stream was put somewhere else (reset or seek), whatever is decoded
+ * next isn't part of a pass being recorded or replayed. */
+void reset_loop_cache(loop_cache_data * cache);
+
+/* Stop replaying, decoding from the loop end the decoder was left at up
+ * to where the replay got, so the decoder is there too. */
+void leave_loop_cache_replay(loop_cache_data * cache, VGMSTREAM * vgmstream);
+
+void render_vgmstream_loop_cached(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
+#endif
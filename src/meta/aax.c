@@ -219,6 +219,8 @@ VGMSTREAM * init_vgmstream_aax(STREAMFILE *streamFile) {
         if (adx->loop_flag != 0)
             goto fail;
 
+        setup_vgmstream_layout(adx);
+
         /* save start things so we can restart for seeking/looping */
         /* copy the channels */
         memcpy(adx->start_ch,adx->ch,sizeof(VGMSTREAMCHANNEL)*adx->channels);
@@ -167,14 +167,11 @@ VGMSTREAM * init_vgmstream_adx(STREAMFILE *streamFile) {
             if (coding_type == coding_CRI_ADX_enc_8 ||
                 coding_type == coding_CRI_ADX_enc_9)
             {
-                int j;
+                /* frames of each channel are one after the other */
                 vgmstream->ch[i].adx_channels = channel_count;
-                vgmstream->ch[i].adx_xor = xor_start;
+                vgmstream->ch[i].adx_xor = adx_key_at(xor_start,xor_mult,xor_add,i);
                 vgmstream->ch[i].adx_mult = xor_mult;
                 vgmstream->ch[i].adx_add = xor_add;
-
-                for (j=0;j<i;j++)
-                    adx_next_key(&vgmstream->ch[i]);
             }
         }
     }
@@ -18,7 +18,7 @@ static STREAMFILE *open_aix_with_STREAMFILE(STREAMFILE *file,off_t start_offset,
 VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
     
 	VGMSTREAM * vgmstream = NULL;
-    STREAMFILE * streamFileAIX = NULL;
+    STREAMFILE ** streamFilesAIX = NULL;
     STREAMFILE * streamFileADX = NULL;
     char filename[260];
     off_t *segment_offset = NULL;
@@ -121,11 +121,17 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
         }
     }
 
-    /*streamFileAIX = streamFile->open(streamFile,filename,sample_rate*0.0375*2/32*18segment_count);*/
-    streamFileAIX = streamFile->open(streamFile,filename,sample_rate*0.1*segment_count);
-    if (!streamFileAIX) goto fail;
+    /* each stream reads from its own file so they can be decoded apart */
+    streamFilesAIX = calloc(stream_count,sizeof(STREAMFILE *));
+    if (!streamFilesAIX) goto fail;
+    for (i = 0; i < stream_count; i++)
+    {
+        /*streamFilesAIX[i] = streamFile->open(streamFile,filename,sample_rate*0.0375*2/32*18segment_count);*/
+        streamFilesAIX[i] = streamFile->open(streamFile,filename,sample_rate*0.1*segment_count);
+        if (!streamFilesAIX[i]) goto fail;
+    }
 
-    data = malloc(sizeof(aix_codec_data));
+    data = calloc(1,sizeof(aix_codec_data));
     if (!data) goto fail;
     data->segment_count = segment_count;
     data->stream_count = stream_count;
@@ -141,13 +147,13 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
     /* for each segment */
     for (i = 0; i < segment_count; i++)
     {
-        int j;
+        int j, segment_channels = 0;
         /* for each stream */
         for (j = 0; j < stream_count; j++)
         {
             VGMSTREAM *adx;
             /*printf("try opening segment %d/%d stream %d/%d %x\n",i,segment_count,j,stream_count,segment_offset[i]);*/
-            streamFileADX = open_aix_with_STREAMFILE(streamFileAIX,segment_offset[i],j);
+            streamFileADX = open_aix_with_STREAMFILE(streamFilesAIX[j],segment_offset[i],j);
             if (!streamFileADX) goto fail;
             adx = data->adxs[i*stream_count+j] = init_vgmstream_adx(streamFileADX);
             if (!adx)
@@ -157,6 +163,9 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
             if (adx->num_samples != data->sample_counts[i] ||
                     adx->loop_flag != 0)
                 goto fail;
+            segment_channels += adx->channels;
+
+            setup_vgmstream_layout(adx);
 
             /* save start things so we can restart for seeking/looping */
             /* copy the channels */
@@ -165,6 +174,10 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
             memcpy(adx->start_vgmstream,adx,sizeof(VGMSTREAM));
 
         }
+
+        /* the streams' channels make up the whole */
+        if (segment_channels != channel_count)
+            goto fail;
     }
 
     if (segment_count > 1)
@@ -183,7 +196,18 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
             loop_end_sample = sample_count;
     }
 
+    /* each channel is rendered on its own, then interleaved */
+    data->channel_buffers = calloc(channel_count,sizeof(sample *));
+    if (!data->channel_buffers) goto fail;
+    for (i = 0; i < channel_count; i++)
+    {
+        data->channel_buffers[i] = malloc(AIX_BUFFER_SIZE*sizeof(sample));
+        if (!data->channel_buffers[i]) goto fail;
+    }
+    data->buffer_samples = AIX_BUFFER_SIZE;
+
     vgmstream = allocate_vgmstream(channel_count,loop_flag);
+    if (!vgmstream) goto fail;
 
     vgmstream->num_samples = sample_count;
     vgmstream->sample_rate = sample_rate;
@@ -195,10 +219,13 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
     vgmstream->layout_type = layout_aix;
     vgmstream->meta_type = meta_AIX;
 
-    vgmstream->ch[0].streamfile = streamFileAIX;
+    /* there are at least as many channels as streams */
+    for (i = 0; i < stream_count; i++)
+        vgmstream->ch[i].streamfile = streamFilesAIX[i];
     data->current_segment = 0;
 
     vgmstream->codec_data = data;
+    free(streamFilesAIX);
     free(segment_offset);
     free(samples_in_segment);
 
@@ -206,7 +233,11 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
 
     /* clean up anything we may have opened */
 fail:
-    if (streamFileAIX) close_streamfile(streamFileAIX);
+    if (streamFilesAIX) {
+        for (i = 0; i < stream_count; i++)
+            if (streamFilesAIX[i]) close_streamfile(streamFilesAIX[i]);
+        free(streamFilesAIX);
+    }
     if (streamFileADX) close_streamfile(streamFileADX);
     if (vgmstream) close_vgmstream(vgmstream);
     if (samples_in_segment) free(samples_in_segment);
@@ -224,6 +255,12 @@ fail:
         {
             free(data->sample_counts);
         }
+        if (data->channel_buffers)
+        {
+            for (i=0;i<channel_count;i++)
+                free(data->channel_buffers[i]);
+            free(data->channel_buffers);
+        }
         free(data);
     }
     return NULL;
@@ -246,23 +246,31 @@ VGMSTREAM * init_vgmstream_sqex_scd(STREAMFILE *streamFile) {
 
                 }
 
-                /* the primary streamfile we'll be using */
-                file = streamFile->open(streamFile,filename,stride_size);
-                if (!file)
+                data = calloc(1,sizeof(scd_int_codec_data));
+                if (!data)
                     goto fail;
-
-                vgmstream->ch[0].streamfile = file;
-
-                data = malloc(sizeof(scd_int_codec_data));
                 data->substream_count = channel_count;
                 data->substreams = calloc(channel_count, sizeof(VGMSTREAM *));
                 data->intfiles = calloc(channel_count, sizeof(STREAMFILE *));
+                data->buffers = calloc(channel_count, sizeof(sample *));
 
                 vgmstream->codec_data = data;
+                if (!data->substreams || !data->intfiles || !data->buffers)
+                    goto fail;
 
                 for (i=0;i<channel_count;i++) {
-                    STREAMFILE * intfile =
-                        open_scdint_with_STREAMFILE(file, "ARBITRARY.DSP", start_offset+interleave_size*i, interleave_size, stride_size, total_size);
+                    STREAMFILE * intfile;
+
+                    /* each substream reads its own file, so they can be
+                     * decoded on different threads */
+                    file = streamFile->open(streamFile,filename,interleave_size);
+                    if (!file)
+                        goto fail;
+                    vgmstream->ch[i].streamfile = file;
+
+                    intfile = open_scdint_with_STREAMFILE(file, "ARBITRARY.DSP", start_offset+interleave_size*i, interleave_size, stride_size, total_size);
+                    if (!intfile)
+                        goto fail;
 
                     data->substreams[i] = init_vgmstream_ngc_dsp_std(intfile);
                     data->intfiles[i] = intfile;
@@ -270,13 +278,19 @@ VGMSTREAM * init_vgmstream_sqex_scd(STREAMFILE *streamFile) {
                         goto fail;
 
                     /* TODO: only handles mono substreams, though that's all we have with DSP */
+                    setup_vgmstream_layout(data->substreams[i]);
+
                     /* save start things so we can restart for seeking/looping */
                     /* copy the channels */
                     memcpy(data->substreams[i]->start_ch,data->substreams[i]->ch,sizeof(VGMSTREAMCHANNEL)*1);
                     /* copy the whole VGMSTREAM */
                     memcpy(data->substreams[i]->start_vgmstream,data->substreams[i],sizeof(VGMSTREAM));
 
+                    data->buffers[i] = malloc(SCD_INT_BUFFER_SIZE*sizeof(sample));
+                    if (!data->buffers[i])
+                        goto fail;
                 }
+                data->buffer_samples = SCD_INT_BUFFER_SIZE;
 
             }
             break;
@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <math.h>
+#include "play.h"
+#include "kernels.h"
+
+void free_play_config(play_config_data * play) {
+    free(play);
+}
+
+void set_play_position(play_config_data * play, int32_t position) {
+    if (!play) return;
+
+    play->position = position;
+}
+
+/* Also in the start copy, so a reset keeps it. */
+static int set_loop(VGMSTREAM * vgmstream, int loop_flag, int32_t loop_start_sample, int32_t loop_end_sample) {
+    VGMSTREAM * start_vgmstream = vgmstream->start_vgmstream;
+
+    /* a stream opened without a loop has no place to keep the loop start */
+    if (loop_flag && !vgmstream->loop_ch) {
+        vgmstream->loop_ch = calloc(vgmstream->channels,sizeof(VGMSTREAMCHANNEL));
+        if (!vgmstream->loop_ch) return 0;
+    }
+
+    vgmstream->loop_flag = loop_flag;
+    vgmstream->loop_start_sample = loop_start_sample;
+    vgmstream->loop_end_sample = loop_end_sample;
+
+    if (start_vgmstream) {
+        start_vgmstream->loop_flag = loop_flag;
+        start_vgmstream->loop_start_sample = loop_start_sample;
+        start_vgmstream->loop_end_sample = loop_end_sample;
+        start_vgmstream->loop_ch = vgmstream->loop_ch;
+    }
+
+    /* the layout just renders the substreams, they do the looping */
+    if (vgmstream->layout_type==layout_scd_int) {
+        scd_int_codec_data *data = vgmstream->codec_data;
+        int i;
+
+        for (i=0;i<data->substream_count;i++) {
+            if (!set_loop(data->substreams[i],loop_flag,loop_start_sample,loop_end_sample))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+int vgmstream_set_play_config(VGMSTREAM * vgmstream, const vgmstream_play_config * config) {
+    play_config_data * play = vgmstream->play_config;
+    int loop_flag;
+    int32_t loop_start_sample, loop_end_sample;
+
+    if (!play) {
+        play = calloc(1,sizeof(play_config_data));
+        if (!play) return 0;
+
+        play->loop_flag = vgmstream->loop_flag;
+        play->loop_start_sample = vgmstream->loop_start_sample;
+        play->loop_end_sample = vgmstream->loop_end_sample;
+        play->position = vgmstream->current_sample;
+        vgmstream->play_config = play;
+    }
+
+    if (config) {
+        play->config = *config;
+    }
+    else {
+        vgmstream_play_config defaults = {0};
+
+        defaults.loop_count = PLAY_DEFAULT_LOOP_COUNT;
+        defaults.fade_seconds = PLAY_DEFAULT_FADE_SECONDS;
+        defaults.fade_delay_seconds = PLAY_DEFAULT_FADE_DELAY_SECONDS;
+        play->config = defaults;
+    }
+    config = &play->config;
+
+    /* always from the loop the stream came with, the config may change */
+    loop_flag = play->loop_flag;
+    loop_start_sample = play->loop_start_sample;
+    loop_end_sample = play->loop_end_sample;
+
+    /* AIX and AAX loop by going back to a segment start, only the loop
+     * they were opened with (at a segment start) can be played */
+    if ((config->force_loop == 2 || (config->force_loop == 1 && !loop_flag)) &&
+            vgmstream->layout_type != layout_aix && vgmstream->layout_type != layout_aax) {
+        loop_flag = 1;
+        loop_start_sample = 0;
+        loop_end_sample = vgmstream->num_samples;
+    }
+    if (config->ignore_loop)
+        loop_flag = 0;
+
+    if (!set_loop(vgmstream,loop_flag,loop_start_sample,loop_end_sample))
+        return 0;
+
+    play->play_forever = loop_flag && config->play_forever;
+    play->play_samples = get_vgmstream_play_samples(config->loop_count,
+            config->fade_seconds,config->fade_delay_seconds,vgmstream);
+
+    /* only looping streams are cut short, the others end on their own */
+    play->fade_samples = 0;
+    if (loop_flag && !play->play_forever && config->fade_seconds > 0) {
+        play->fade_samples = config->fade_seconds * vgmstream->sample_rate;
+        if (play->fade_samples > play->play_samples)
+            play->fade_samples = play->play_samples;
+    }
+
+    return 1;
+}
+
+int32_t get_vgmstream_play_length(VGMSTREAM * vgmstream) {
+    if (!vgmstream->play_config && !vgmstream_set_play_config(vgmstream,NULL))
+        return 0;
+
+    if (vgmstream->play_config->play_forever)
+        return -1;
+    return vgmstream->play_config->play_samples;
+}
+
+/* 2.30 volume samples_into_fade into the fade */
+static int32_t fade_volume(play_config_data * play, int32_t samples_into_fade) {
+    if (play->config.fade_curve == fade_curve_log) {
+        double t = (double)samples_into_fade / play->fade_samples;
+
+        /* -60 dB over the fade, shifted down to reach silence */
+        double gain = (pow(10.0,-3.0*t) - 0.001) / 0.999;
+        return (int32_t)(gain * (1 << 30));
+    }
+
+    return (int32_t)(((int64_t)(play->fade_samples - samples_into_fade) << 30) / play->fade_samples);
+}
+
+/* The volume is worked out exactly at the ends of each segment of the fade
+ * and stepped linearly in between by the kernel, so the steps can't add up
+ * errors (and curves are followed closely). Segments are counted from the
+ * fade start, so the output doesn't depend on how the renders split it. */
+static void fade_out(play_config_data * play, sample * buffer, int32_t sample_count, int channels) {
+    const vgmstream_kernels * kernels = get_kernels();
+    int32_t fade_start = play->play_samples - play->fade_samples;
+    int32_t first, samples_into_fade;
+
+    if (play->fade_samples <= 0)
+        return;
+
+    /* the fade's first sample is still at full volume */
+    first = fade_start + 1 - play->position;
+    if (first < 0) first = 0;
+    if (first >= sample_count)
+        return;
+
+    samples_into_fade = play->position + first - fade_start;
+    buffer += first*channels;
+    sample_count -= first;
+
+    while (sample_count > 0) {
+        int32_t segment_start = samples_into_fade - samples_into_fade % FADE_SEGMENT_SAMPLES;
+        int32_t segment_end = segment_start + FADE_SEGMENT_SAMPLES;
+        int32_t volume, volume_step, samples_to_do;
+
+        if (segment_end > play->fade_samples)
+            segment_end = play->fade_samples;
+
+        volume = fade_volume(play,segment_start);
+        volume_step = (fade_volume(play,segment_end) - volume) / (segment_end - segment_start);
+        volume += volume_step * (samples_into_fade - segment_start);
+
+        samples_to_do = segment_end - samples_into_fade;
+        if (samples_to_do > sample_count) samples_to_do = sample_count;
+
+        kernels->fade_linear(buffer,channels,samples_to_do,volume,volume_step);
+
+        buffer += samples_to_do*channels;
+        sample_count -= samples_to_do;
+        samples_into_fade += samples_to_do;
+    }
+}
+
+int32_t render_vgmstream_play(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    play_config_data * play = vgmstream->play_config;
+
+    if (!play) {
+        if (!vgmstream_set_play_config(vgmstream,NULL))
+            return 0;
+        play = vgmstream->play_config;
+    }
+
+    if (!play->play_forever) {
+        if (play->position >= play->play_samples)
+            return 0;
+        if (sample_count > play->play_samples - play->position)
+            sample_count = play->play_samples - play->position;
+    }
+
+    render_vgmstream(buffer,sample_count,vgmstream);
+    fade_out(play,buffer,sample_count,vgmstream->channels);
+
+    /* nothing to count towards, and it would overflow in time */
+    if (!play->play_forever)
+        play->position += sample_count;
+    return sample_count;
+}
@@ -0,0 +1,38 @@
+/*
+ * play.h - how long a stream is played and the fade at the end of it
+ */
+
+#ifndef _PLAY_H
+#define _PLAY_H
+
+#include "vgmstream.h"
+
+/* what players have always used when the user doesn't say */
+#define PLAY_DEFAULT_LOOP_COUNT 2.0
+#define PLAY_DEFAULT_FADE_SECONDS 10.0
+#define PLAY_DEFAULT_FADE_DELAY_SECONDS 0.0
+
+/* fades are stepped linearly between exact volumes this far apart */
+#define FADE_SEGMENT_SAMPLES 64
+
+typedef struct play_config_data {
+    vgmstream_play_config config;
+
+    /* loop as the stream was opened, the config is applied to these */
+    int loop_flag;
+    int32_t loop_start_sample;
+    int32_t loop_end_sample;
+
+    int play_forever;       /* a looping stream with play_forever, no end */
+    int32_t play_samples;   /* where play ends */
+    int32_t fade_samples;   /* the fade before that, 0 for none */
+
+    int32_t position;       /* samples played, loops included */
+} play_config_data;
+
+void free_play_config(play_config_data * play);
+
+/* The stream was reset or seeked, play goes on from position. */
+void set_play_position(play_config_data * play, int32_t position);
+
+#endif
@@ -0,0 +1,739 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "seek.h"
+#include "state.h"
+#include "loop_cache.h"
+#include "play.h"
+
+/* where checkpoints are kept between processes, NULL if they aren't */
+static char * seek_cache_dir = NULL;
+
+void free_seek_index(seek_index_data * index) {
+    if (!index) return;
+
+    free(index->checkpoints);
+    free(index->checkpoint_ch);
+    free(index->checkpoint_loop_ch);
+    free(index->buffer);
+    free(index);
+}
+
+/* Streams with codec_data have state outside of the VGMSTREAM that a copy
+ * doesn't catch (and often can't be copied at all). */
+static int vgmstream_can_checkpoint(VGMSTREAM * vgmstream) {
+    return vgmstream->codec_data == NULL;
+}
+
+/* reset_vgmstream goes back to the loop settings the stream was opened with,
+ * keep the ones the caller set instead */
+static void reset_keeping_loop(VGMSTREAM * vgmstream) {
+    int loop_flag = vgmstream->loop_flag;
+    int32_t loop_start_sample = vgmstream->loop_start_sample;
+    int32_t loop_end_sample = vgmstream->loop_end_sample;
+    VGMSTREAMCHANNEL * loop_ch = vgmstream->loop_ch;
+
+    reset_vgmstream(vgmstream);
+
+    vgmstream->loop_flag = loop_flag;
+    vgmstream->loop_start_sample = loop_start_sample;
+    vgmstream->loop_end_sample = loop_end_sample;
+    vgmstream->loop_ch = loop_ch;
+}
+
+/* Streams where the state at any sample follows from the start state: PCM
+ * has nothing but the position, and the block codecs decode from the block
+ * header when there is a block cache (see decode_vgmstream_cached). */
+static int vgmstream_can_seek_direct(VGMSTREAM * vgmstream) {
+    if (vgmstream->codec_data)
+        return 0;
+
+    if (vgmstream->layout_type == layout_interleave) {
+        switch (vgmstream->coding_type) {
+            case coding_PCM16LE:
+            case coding_PCM16BE:
+            case coding_PCM8:
+            case coding_PCM8_U:
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    if (vgmstream->layout_type == layout_none) {
+        switch (vgmstream->coding_type) {
+            case coding_PCM16LE:
+            case coding_PCM16LE_int:
+            case coding_PCM16LE_XOR_int:
+            case coding_PCM16BE:
+            case coding_PCM8:
+            case coding_PCM8_int:
+            case coding_PCM8_SB_int:
+            case coding_PCM8_U:
+            case coding_PCM8_U_int:
+                return 1;
+            case coding_MSADPCM:
+            case coding_MS_IMA:
+            case coding_APPLE_IMA4:
+                return vgmstream->block_cache != NULL;
+            default:
+                return 0;
+        }
+    }
+
+    return 0;
+}
+
+/* Moves channels (at the start state) to where decoding sample_position
+ * samples leaves them, returns the samples_into_block for it. */
+static int32_t direct_position(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * ch, int32_t sample_position) {
+    int32_t blocks = 0;
+    off_t block_step = 0;
+    int chan;
+
+    if (vgmstream->layout_type == layout_interleave) {
+        int32_t block_samples = vgmstream->interleave_block_size /
+            get_vgmstream_frame_size(vgmstream) * get_vgmstream_samples_per_frame(vgmstream);
+
+        blocks = sample_position / block_samples;
+        block_step = vgmstream->interleave_block_size*vgmstream->channels;
+        sample_position %= block_samples;
+    }
+    else if (vgmstream->coding_type == coding_MS_IMA) {
+        /* the decoder moves on to the next block, the others find the
+         * block from samples_into_block */
+        blocks = sample_position / get_vgmstream_samples_per_frame(vgmstream);
+        block_step = vgmstream->interleave_block_size;
+    }
+
+    for (chan=0;chan<vgmstream->channels;chan++)
+        ch[chan].offset += blocks*block_step;
+
+    return sample_position;
+}
+
+/* For streams where every pass through the loop decodes the same: if
+ * sample_position is past the loop start, saves what vgmstream_do_loop saves
+ * there, from the state at the start of the stream. Returns the position in
+ * the first pass. */
+static int32_t enter_loop(VGMSTREAM * vgmstream, int32_t sample_position) {
+    int32_t loop_length = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+
+    if (!vgmstream->loop_flag || sample_position < vgmstream->loop_start_sample ||
+            loop_length <= 0)
+        return sample_position;
+
+    memcpy(vgmstream->loop_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+    vgmstream->loop_samples_into_block = vgmstream->samples_into_block;
+    vgmstream->loop_sample = vgmstream->loop_start_sample;
+    vgmstream->loop_block_size = vgmstream->current_block_size;
+    vgmstream->loop_block_offset = vgmstream->current_block_offset;
+    vgmstream->loop_next_block_offset = vgmstream->next_block_offset;
+    vgmstream->hit_loop = 1;
+
+    if (sample_position >= vgmstream->loop_end_sample)
+        sample_position = vgmstream->loop_start_sample +
+            (sample_position - vgmstream->loop_start_sample) % loop_length;
+    return sample_position;
+}
+
+static void seek_direct(VGMSTREAM * vgmstream, int32_t sample_position) {
+    reset_keeping_loop(vgmstream);
+
+    sample_position = enter_loop(vgmstream,sample_position);
+    if (vgmstream->hit_loop)
+        vgmstream->loop_samples_into_block =
+            direct_position(vgmstream,vgmstream->loop_ch,vgmstream->loop_start_sample);
+
+    vgmstream->samples_into_block = direct_position(vgmstream,vgmstream->ch,sample_position);
+    vgmstream->current_sample = sample_position;
+
+    if (vgmstream->block_cache)
+        vgmstream->block_cache->valid = 0;
+}
+
+/* Codecs that seek by themselves, as the loop end does for them (see
+ * vgmstream_do_loop). Returns 0 if the stream isn't one or the codec can't
+ * get there, it's reset then. */
+static int seek_codec(VGMSTREAM * vgmstream, int32_t sample_position) {
+#ifdef VGM_USE_VORBIS
+    if (vgmstream->coding_type==coding_ogg_vorbis) {
+        ogg_vorbis_codec_data *data = vgmstream->codec_data;
+
+        reset_keeping_loop(vgmstream);
+        sample_position = enter_loop(vgmstream,sample_position);
+
+        /* bisects the pages by granule position, then decodes up to the
+         * sample (ov_pcm_seek_page would stop at the page start) */
+        if (ov_pcm_seek(&data->ogg_vorbis_file,sample_position) != 0) {
+            reset_keeping_loop(vgmstream);
+            return 0;
+        }
+
+        vgmstream->current_sample = sample_position;
+        return 1;
+    }
+#endif
+#ifdef VGM_USE_MPEG
+    /* won't work for fake MPEG */
+    if (vgmstream->layout_type==layout_mpeg) {
+        mpeg_codec_data *data = vgmstream->codec_data;
+        off_t input_offset;
+
+        reset_keeping_loop(vgmstream);
+        sample_position = enter_loop(vgmstream,sample_position);
+
+        /* mpg123 finds the frame in the index it keeps of the frames fed so
+         * far, or goes on from the last one, and tells where to feed from */
+        if (mpg123_feedseek(data->m,sample_position,SEEK_SET,&input_offset) < 0) {
+            reset_keeping_loop(vgmstream);
+            return 0;
+        }
+        vgmstream->ch[0].offset = vgmstream->ch[0].channel_start_offset + input_offset;
+        data->buffer_full = data->buffer_used = 0;
+
+        vgmstream->current_sample = sample_position;
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/* Always decodes, past the loop cache: while it replays, the channels stay
+ * at the loop end, and a checkpoint taken then would be of nowhere. */
+static void skip_samples(VGMSTREAM * vgmstream, sample * buffer, int32_t samples) {
+    if (!vgmstream->layout_render)
+        setup_vgmstream_layout(vgmstream);
+    if (!vgmstream->layout_render)
+        return;
+
+    while (samples > 0) {
+        int32_t count = samples > SEEK_BUFFER_SAMPLES ? SEEK_BUFFER_SAMPLES : samples;
+
+        vgmstream->layout_render(buffer,count,vgmstream);
+        samples -= count;
+    }
+}
+
+/* Checkpoint files start with what the checkpoints depend on, a file for
+ * another stream or with other loop settings isn't used. */
+#define SEEK_FILE_VERSION 3
+
+static void put_seek_header(state_buffer * sb, seek_index_data * index, VGMSTREAM * vgmstream) {
+    state_put_bytes(sb,(const uint8_t *)"VGSK",4);
+    state_put_32(sb,SEEK_FILE_VERSION);
+    state_put_stream(sb,vgmstream);
+    state_put_32(sb,index->loop_flag);
+    state_put_32(sb,index->loop_start_sample);
+    state_put_32(sb,index->loop_end_sample);
+    state_put_32(sb,index->interval);
+}
+
+static void put_seek_index(state_buffer * sb, seek_index_data * index, VGMSTREAM * vgmstream) {
+    int i, chan;
+
+    put_seek_header(sb,index,vgmstream);
+
+    state_put_32(sb,index->loop_passes);
+    state_put_32(sb,index->loop_settled);
+    state_put_32(sb,index->count);
+
+    for (i=0;i<index->count;i++) {
+        state_put_position(sb,&index->checkpoints[i]);
+        for (chan=0;chan<vgmstream->channels;chan++)
+            state_put_channel(sb,&index->checkpoint_ch[i*vgmstream->channels+chan]);
+        if (index->checkpoints[i].hit_loop) {
+            for (chan=0;chan<vgmstream->channels;chan++)
+                state_put_channel(sb,&index->checkpoint_loop_ch[i*vgmstream->channels+chan]);
+        }
+    }
+}
+
+/* Reads the checkpoints into index, replacing the ones it had. Returns 0 if
+ * the data isn't for this stream, index is left alone then. */
+static int get_seek_index_data(state_buffer * sb, seek_index_data * index, VGMSTREAM * vgmstream) {
+    state_buffer header;
+    uint8_t * expected = NULL;
+    VGMSTREAM * checkpoints = NULL;
+    VGMSTREAMCHANNEL * checkpoint_ch = NULL;
+    VGMSTREAMCHANNEL * checkpoint_loop_ch = NULL;
+    size_t ch_size = sizeof(VGMSTREAMCHANNEL)*vgmstream->channels;
+    int32_t loop_passes, loop_settled, count;
+    int i, chan;
+
+    /* same header as we'd write */
+    memset(&header,0,sizeof(header));
+    put_seek_header(&header,index,vgmstream);
+    header.size = header.pos;
+    header.pos = 0;
+    expected = malloc(header.size);
+    if (!expected) goto fail;
+    header.buf = expected;
+    put_seek_header(&header,index,vgmstream);
+    if (sb->size - sb->pos < header.size ||
+            memcmp(sb->buf+sb->pos,expected,header.size))
+        goto fail;
+    sb->pos += header.size;
+
+    loop_passes = state_get_32(sb);
+    loop_settled = state_get_32(sb);
+    count = state_get_32(sb);
+    /* a checkpoint can't be smaller than its channels' offsets */
+    if (sb->error || loop_passes < 0 || loop_passes > SEEK_LOOP_PASSES ||
+            count < 0 || count > (sb->size - sb->pos) / (8*vgmstream->channels))
+        goto fail;
+
+    if (count > 0) {
+        checkpoints = malloc(count*sizeof(VGMSTREAM));
+        if (!checkpoints) goto fail;
+        checkpoint_ch = malloc(count*ch_size);
+        if (!checkpoint_ch) goto fail;
+        checkpoint_loop_ch = malloc(count*ch_size);
+        if (!checkpoint_loop_ch) goto fail;
+    }
+
+    for (i=0;i<count;i++) {
+        /* everything but the position is as it was at the start */
+        memcpy(&checkpoints[i],vgmstream->start_vgmstream,sizeof(VGMSTREAM));
+        checkpoints[i].loop_flag = index->loop_flag;
+        checkpoints[i].loop_start_sample = index->loop_start_sample;
+        checkpoints[i].loop_end_sample = index->loop_end_sample;
+        state_get_position(sb,&checkpoints[i]);
+
+        memcpy(&checkpoint_ch[i*vgmstream->channels],vgmstream->start_ch,ch_size);
+        for (chan=0;chan<vgmstream->channels;chan++)
+            state_get_channel(sb,vgmstream,&checkpoint_ch[i*vgmstream->channels+chan]);
+        if (checkpoints[i].hit_loop) {
+            memcpy(&checkpoint_loop_ch[i*vgmstream->channels],vgmstream->start_ch,ch_size);
+            for (chan=0;chan<vgmstream->channels;chan++)
+                state_get_channel(sb,vgmstream,&checkpoint_loop_ch[i*vgmstream->channels+chan]);
+        }
+    }
+
+    if (sb->error || sb->pos != sb->size)
+        goto fail;
+
+    free(index->checkpoints);
+    free(index->checkpoint_ch);
+    free(index->checkpoint_loop_ch);
+    index->checkpoints = checkpoints;
+    index->checkpoint_ch = checkpoint_ch;
+    index->checkpoint_loop_ch = checkpoint_loop_ch;
+    index->count = count;
+    index->capacity = count;
+    index->loop_passes = loop_passes;
+    index->loop_settled = loop_settled;
+
+    free(expected);
+    return 1;
+
+fail:
+    free(expected);
+    free(checkpoints);
+    free(checkpoint_ch);
+    free(checkpoint_loop_ch);
+    return 0;
+}
+
+static int write_seek_index(seek_index_data * index, VGMSTREAM * vgmstream, const char * filename) {
+    state_buffer sb;
+    char * temp_name = NULL;
+    FILE * outfile = NULL;
+    int ok = 0;
+
+    memset(&sb,0,sizeof(sb));
+    put_seek_index(&sb,index,vgmstream);
+    sb.size = sb.pos;
+    sb.pos = 0;
+    sb.buf = malloc(sb.size);
+    if (!sb.buf) goto fail;
+    put_seek_index(&sb,index,vgmstream);
+
+    /* written apart and renamed, so a reader never sees half a file */
+    temp_name = malloc(strlen(filename)+5);
+    if (!temp_name) goto fail;
+    sprintf(temp_name,"%s.tmp",filename);
+
+    outfile = fopen(temp_name,"wb");
+    if (!outfile) goto fail;
+    if (fwrite(sb.buf,1,sb.size,outfile) != sb.size) goto fail;
+    if (fclose(outfile)) {
+        outfile = NULL;
+        goto fail;
+    }
+    outfile = NULL;
+
+    remove(filename);
+    if (rename(temp_name,filename)) goto fail;
+    ok = 1;
+
+fail:
+    if (outfile) fclose(outfile);
+    if (!ok && temp_name) remove(temp_name);
+    free(temp_name);
+    free(sb.buf);
+    return ok;
+}
+
+static int read_seek_index(seek_index_data * index, VGMSTREAM * vgmstream, const char * filename) {
+    state_buffer sb;
+    FILE * infile = NULL;
+    long size;
+    int ok = 0;
+
+    memset(&sb,0,sizeof(sb));
+
+    infile = fopen(filename,"rb");
+    if (!infile) goto fail;
+    if (fseek(infile,0,SEEK_END)) goto fail;
+    size = ftell(infile);
+    if (size <= 0 || fseek(infile,0,SEEK_SET)) goto fail;
+
+    sb.size = size;
+    sb.buf = malloc(sb.size);
+    if (!sb.buf) goto fail;
+    if (fread(sb.buf,1,sb.size,infile) != sb.size) goto fail;
+
+    ok = get_seek_index_data(&sb,index,vgmstream);
+
+fail:
+    if (infile) fclose(infile);
+    free(sb.buf);
+    return ok;
+}
+
+/* The cache file is named after a hash of the stream's settings, the
+ * start of its file and pieces spread over the rest (hashing all of it
+ * would cost about as much as decoding it). */
+#define SEEK_HASH_START 0x8000
+#define SEEK_HASH_PIECES 16
+#define SEEK_HASH_PIECE 0x1000
+
+static uint64_t seek_hash_bytes(uint64_t hash, const uint8_t * bytes, size_t length) {
+    size_t i;
+
+    /* FNV-1a */
+    for (i=0;i<length;i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static char * seek_cache_name(seek_index_data * index, VGMSTREAM * vgmstream) {
+    STREAMFILE * streamfile = vgmstream->ch[0].streamfile;
+    uint8_t buf[SEEK_HASH_START];
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    state_buffer header;
+    size_t file_size, length;
+    char * name;
+    int i;
+
+    if (!streamfile) return NULL;
+
+    memset(&header,0,sizeof(header));
+    put_seek_header(&header,index,vgmstream);
+    if (header.pos > sizeof(buf)) return NULL;
+    header.size = header.pos;
+    header.pos = 0;
+    header.buf = buf;
+    put_seek_header(&header,index,vgmstream);
+    hash = seek_hash_bytes(hash,buf,header.size);
+
+    file_size = get_streamfile_size(streamfile);
+    put_32bitLE(buf,(int32_t)file_size);
+    hash = seek_hash_bytes(hash,buf,4);
+
+    length = read_streamfile(buf,0,SEEK_HASH_START,streamfile);
+    hash = seek_hash_bytes(hash,buf,length);
+    for (i=1;i<SEEK_HASH_PIECES;i++) {
+        length = read_streamfile(buf,(off_t)(file_size/SEEK_HASH_PIECES)*i,SEEK_HASH_PIECE,streamfile);
+        hash = seek_hash_bytes(hash,buf,length);
+    }
+
+    name = malloc(strlen(seek_cache_dir)+1+16+8+1);
+    if (!name) return NULL;
+    sprintf(name,"%s/%08x%08x.vgmseek",seek_cache_dir,
+            (unsigned int)(hash >> 32),(unsigned int)(hash & 0xFFFFFFFF));
+    return name;
+}
+
+static seek_index_data * get_seek_index(VGMSTREAM * vgmstream) {
+    seek_index_data * index = vgmstream->seek_index;
+
+    /* checkpoints taken with other loop settings went another way */
+    if (index && (index->loop_flag != vgmstream->loop_flag ||
+                index->loop_start_sample != vgmstream->loop_start_sample ||
+                index->loop_end_sample != vgmstream->loop_end_sample)) {
+        free_seek_index(index);
+        vgmstream->seek_index = index = NULL;
+    }
+    if (index) return index;
+
+    index = calloc(1,sizeof(seek_index_data));
+    if (!index) return NULL;
+    index->buffer = malloc(SEEK_BUFFER_SAMPLES*vgmstream->channels*sizeof(sample));
+    if (!index->buffer) {
+        free(index);
+        return NULL;
+    }
+    index->interval = SEEK_CHECKPOINT_SAMPLES;
+    index->loop_flag = vgmstream->loop_flag;
+    index->loop_start_sample = vgmstream->loop_start_sample;
+    index->loop_end_sample = vgmstream->loop_end_sample;
+
+    vgmstream->seek_index = index;
+
+    /* another process may have passed here already */
+    if (seek_cache_dir) {
+        char * name = seek_cache_name(index,vgmstream);
+        if (name) {
+            read_seek_index(index,vgmstream,name);
+            free(name);
+        }
+    }
+
+    return index;
+}
+
+/* returns 0 if there is no memory for it */
+static int add_checkpoint(seek_index_data * index, VGMSTREAM * vgmstream) {
+    size_t ch_size = sizeof(VGMSTREAMCHANNEL)*vgmstream->channels;
+
+    if (index->count == index->capacity) {
+        int capacity = index->capacity ? index->capacity*2 : 16;
+        VGMSTREAM * checkpoints;
+        VGMSTREAMCHANNEL * checkpoint_ch;
+
+        checkpoints = realloc(index->checkpoints,capacity*sizeof(VGMSTREAM));
+        if (!checkpoints) return 0;
+        index->checkpoints = checkpoints;
+        checkpoint_ch = realloc(index->checkpoint_ch,capacity*ch_size);
+        if (!checkpoint_ch) return 0;
+        index->checkpoint_ch = checkpoint_ch;
+        checkpoint_ch = realloc(index->checkpoint_loop_ch,capacity*ch_size);
+        if (!checkpoint_ch) return 0;
+        index->checkpoint_loop_ch = checkpoint_ch;
+        index->capacity = capacity;
+    }
+
+    memcpy(&index->checkpoints[index->count],vgmstream,sizeof(VGMSTREAM));
+    memcpy(&index->checkpoint_ch[index->count*vgmstream->channels],vgmstream->ch,ch_size);
+    /* the loop end may have changed its history since the loop start */
+    if (vgmstream->hit_loop)
+        memcpy(&index->checkpoint_loop_ch[index->count*vgmstream->channels],vgmstream->loop_ch,ch_size);
+    index->count++;
+    return 1;
+}
+
+static void restore_checkpoint(seek_index_data * index, int checkpoint, VGMSTREAM * vgmstream) {
+    size_t ch_size = sizeof(VGMSTREAMCHANNEL)*vgmstream->channels;
+    VGMSTREAMCHANNEL * loop_ch = vgmstream->loop_ch;
+    struct loop_cache_data * loop_cache = vgmstream->loop_cache;
+    struct play_config_data * play_config = vgmstream->play_config;
+
+    /* The other pointers in the copy are the same as the ones in vgmstream.
+     * Checkpoints read from a file are made from start_vgmstream, so they
+     * have neither loop_ch (if the caller forced a loop) nor the index, and
+     * the loop cache and play config may have been set up after the
+     * checkpoint was taken. */
+    memcpy(vgmstream,&index->checkpoints[checkpoint],sizeof(VGMSTREAM));
+    vgmstream->loop_ch = loop_ch;
+    vgmstream->seek_index = index;
+    vgmstream->loop_cache = loop_cache;
+    vgmstream->play_config = play_config;
+    reset_loop_cache(loop_cache);
+    memcpy(vgmstream->ch,&index->checkpoint_ch[checkpoint*vgmstream->channels],ch_size);
+    if (vgmstream->hit_loop)
+        memcpy(vgmstream->loop_ch,&index->checkpoint_loop_ch[checkpoint*vgmstream->channels],ch_size);
+
+    /* the cached block is from wherever we were */
+    if (vgmstream->block_cache)
+        vgmstream->block_cache->valid = 0;
+}
+
+void vgmstream_set_seek_cache_dir(const char * path) {
+    free(seek_cache_dir);
+    seek_cache_dir = NULL;
+
+    if (path && path[0]) {
+        seek_cache_dir = malloc(strlen(path)+1);
+        if (seek_cache_dir)
+            strcpy(seek_cache_dir,path);
+    }
+}
+
+int save_vgmstream_seek_index(VGMSTREAM * vgmstream, const char * filename) {
+    seek_index_data * index;
+
+    if (!vgmstream_can_checkpoint(vgmstream))
+        return 0;
+    index = get_seek_index(vgmstream);
+    if (!index) return 0;
+
+    return write_seek_index(index,vgmstream,filename);
+}
+
+int load_vgmstream_seek_index(VGMSTREAM * vgmstream, const char * filename) {
+    seek_index_data * index;
+
+    if (!vgmstream_can_checkpoint(vgmstream))
+        return 0;
+    index = get_seek_index(vgmstream);
+    if (!index) return 0;
+
+    return read_seek_index(index,vgmstream,filename);
+}
+
+/* Goes to sample_position from the closest checkpoint, taking the missing
+ * ones up to covered samples of play on the way. Returns 1 if it took any. */
+static int seek_checkpointed(VGMSTREAM * vgmstream, seek_index_data * index, int32_t sample_position, int32_t covered) {
+    int32_t position;
+    int checkpoint, target, added = 0;
+
+    target = sample_position / index->interval - 1;
+    if (covered > 0 && target > (covered-1) / index->interval - 1)
+        target = (covered-1) / index->interval - 1;
+
+    /* closest one we have so far, or the start */
+    checkpoint = target < index->count ? target : index->count-1;
+    if (checkpoint >= 0)
+        restore_checkpoint(index,checkpoint,vgmstream);
+    else
+        reset_keeping_loop(vgmstream);
+    position = (checkpoint+1)*index->interval;
+
+    /* take the missing ones on the way */
+    while (checkpoint < target) {
+        skip_samples(vgmstream,index->buffer,index->interval);
+        position += index->interval;
+        checkpoint++;
+
+        if (!add_checkpoint(index,vgmstream))
+            break;
+        added = 1;
+    }
+
+    skip_samples(vgmstream,index->buffer,sample_position-position);
+    return added;
+}
+
+static int same_loop_history(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * a, VGMSTREAMCHANNEL * b) {
+    int chan;
+
+    for (chan=0;chan<vgmstream->channels;chan++) {
+        if (a[chan].adpcm_history1_32 != b[chan].adpcm_history1_32 ||
+                a[chan].adpcm_history2_32 != b[chan].adpcm_history2_32)
+            return 0;
+    }
+    return 1;
+}
+
+/* A pass through the loop starts from loop_ch, and only its adpcm history
+ * changes from pass to pass (see vgmstream_do_loop). Once a pass ends with
+ * the history it started with, all the passes after it decode the same. */
+static void find_loop_passes(VGMSTREAM * vgmstream, seek_index_data * index) {
+    int32_t loop_samples = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+    size_t ch_size = sizeof(VGMSTREAMCHANNEL)*vgmstream->channels;
+    VGMSTREAMCHANNEL * pass_ch;
+
+    index->loop_passes = 1;
+    index->loop_settled = 1;
+    if (!vgmstream_loop_keeps_history(vgmstream))
+        return;
+
+    pass_ch = malloc(ch_size);
+    if (!pass_ch) {
+        index->loop_settled = 0;
+        return;
+    }
+
+    /* at the end of the first pass, the loop is done on the next render */
+    seek_checkpointed(vgmstream,index,vgmstream->loop_end_sample,vgmstream->loop_end_sample);
+    memcpy(pass_ch,vgmstream->loop_ch,ch_size);
+
+    while (1) {
+        skip_samples(vgmstream,index->buffer,loop_samples);
+        if (same_loop_history(vgmstream,pass_ch,vgmstream->loop_ch))
+            break;
+
+        if (index->loop_passes == SEEK_LOOP_PASSES) {
+            index->loop_settled = 0;
+            break;
+        }
+        memcpy(pass_ch,vgmstream->loop_ch,ch_size);
+        index->loop_passes++;
+    }
+
+    free(pass_ch);
+}
+
+static void seek_to(VGMSTREAM * vgmstream, int32_t sample_position) {
+    seek_index_data * index = NULL;
+    int32_t covered;
+    int added = 0;
+
+    if (sample_position < 0) sample_position = 0;
+
+    if (vgmstream_can_seek_direct(vgmstream)) {
+        seek_direct(vgmstream,sample_position);
+        return;
+    }
+
+    if (seek_codec(vgmstream,sample_position))
+        return;
+
+    if (vgmstream_can_checkpoint(vgmstream))
+        index = get_seek_index(vgmstream);
+
+    if (!index) {
+        /* decode everything up to it */
+        sample * buffer = malloc(SEEK_BUFFER_SAMPLES*vgmstream->channels*sizeof(sample));
+        if (!buffer) return;
+
+        reset_keeping_loop(vgmstream);
+        skip_samples(vgmstream,buffer,sample_position);
+        free(buffer);
+        return;
+    }
+
+    /* Checkpoints are taken up to the pass through the loop all the later
+     * ones repeat, a position in a later pass is the same one in that pass.
+     * If the passes never settle, later positions go on from the last
+     * checkpoint. */
+    covered = vgmstream->num_samples;
+    if (vgmstream->loop_flag && vgmstream->loop_end_sample > vgmstream->loop_start_sample) {
+        int32_t loop_samples = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+        int32_t last_pass;
+
+        if (!index->loop_passes) {
+            find_loop_passes(vgmstream,index);
+            added = 1;
+        }
+
+        covered = vgmstream->loop_end_sample + (index->loop_passes-1)*loop_samples;
+        last_pass = covered - loop_samples;
+        if (index->loop_settled && sample_position >= covered)
+            sample_position = last_pass + (sample_position - last_pass) % loop_samples;
+    }
+
+    if (seek_checkpointed(vgmstream,index,sample_position,covered))
+        added = 1;
+
+    if (added && seek_cache_dir) {
+        char * name = seek_cache_name(index,vgmstream);
+        if (name) {
+            write_seek_index(index,vgmstream,name);
+            free(name);
+        }
+    }
+}
+
+void seek_vgmstream(VGMSTREAM * vgmstream, int32_t sample_position) {
+    if (sample_position < 0) sample_position = 0;
+
+    seek_to(vgmstream,sample_position);
+
+    /* after seek_to, which may reset */
+    set_play_position(vgmstream->play_config,sample_position);
+}
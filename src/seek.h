@@ -0,0 +1,48 @@
+/*
+ * seek.h - checkpoints of the decoder state for seek_vgmstream
+ */
+
+#ifndef _SEEK_H
+#define _SEEK_H
+
+#include "vgmstream.h"
+
+/* samples between checkpoints, a seek decodes less than this */
+#define SEEK_CHECKPOINT_SAMPLES 0x10000
+/* samples per channel decoded at once while getting to the seek point */
+#define SEEK_BUFFER_SAMPLES 0x1000
+
+/* most passes through the loop a seek looks at to find the one all later
+ * passes decode the same as */
+#define SEEK_LOOP_PASSES 8
+
+/* Taken as the stream is decoded by seek_vgmstream, checkpoint n is the
+ * state after (n+1)*interval samples of play. Only for streams that have all
+ * their state in the VGMSTREAM and its channels (no codec_data). */
+typedef struct seek_index_data {
+    int32_t interval;
+    int count;                      /* checkpoints taken so far */
+    int capacity;
+    VGMSTREAM * checkpoints;        /* copies of the VGMSTREAM */
+    VGMSTREAMCHANNEL * checkpoint_ch; /* channels of each, count*channels */
+    VGMSTREAMCHANNEL * checkpoint_loop_ch; /* loop_ch of each, set for the
+                                       ones past the loop start */
+
+    /* loop settings the checkpoints were taken with, the caller may change
+     * them after init (ignore or force looping) */
+    int loop_flag;
+    int32_t loop_start_sample;
+    int32_t loop_end_sample;
+
+    /* Checkpoints cover the first loop_passes passes through the loop, 0
+     * until that is known. When loop_settled every later pass decodes the
+     * same as the last of them, so a seek there goes to that one instead. */
+    int loop_passes;
+    int loop_settled;
+
+    sample * buffer;                /* SEEK_BUFFER_SAMPLES*channels */
+} seek_index_data;
+
+void free_seek_index(seek_index_data * index);
+
+#endif
@@ -0,0 +1,622 @@
+#include <stdlib.h>
+#include <string.h>
+#include "state.h"
+#include "util.h"
+#include "loop_cache.h"
+#include "play.h"
+#include "layout/layout.h"
+
+static uint8_t * state_space(state_buffer * sb, size_t length) {
+    uint8_t * space;
+
+    if (sb->error) return NULL;
+
+    /* only counting the size */
+    if (!sb->buf) {
+        sb->pos += length;
+        return NULL;
+    }
+
+    if (sb->size - sb->pos < length) {
+        sb->error = 1;
+        return NULL;
+    }
+
+    space = sb->buf + sb->pos;
+    sb->pos += length;
+    return space;
+}
+
+void state_put_8(state_buffer * sb, uint8_t value) {
+    uint8_t * p = state_space(sb,1);
+    if (p) p[0] = value;
+}
+
+void state_put_16(state_buffer * sb, int16_t value) {
+    uint8_t * p = state_space(sb,2);
+    if (p) put_16bitLE(p,value);
+}
+
+void state_put_32(state_buffer * sb, int32_t value) {
+    uint8_t * p = state_space(sb,4);
+    if (p) put_32bitLE(p,value);
+}
+
+/* off_t may be 32 or 64 bit, always take 64 */
+void state_put_offset(state_buffer * sb, off_t value) {
+    state_put_32(sb,(int32_t)(value & 0xFFFFFFFF));
+    state_put_32(sb,(int32_t)((value >> 16) >> 16));
+}
+
+void state_put_bytes(state_buffer * sb, const uint8_t * bytes, size_t length) {
+    uint8_t * p = state_space(sb,length);
+    if (p) memcpy(p,bytes,length);
+}
+
+/* the bits of the IEEE double, which is what every platform we build on has */
+void state_put_double(state_buffer * sb, double value) {
+    union { double d; uint64_t u; } bits;
+
+    bits.d = value;
+    state_put_32(sb,(int32_t)(bits.u & 0xFFFFFFFF));
+    state_put_32(sb,(int32_t)(bits.u >> 32));
+}
+
+uint8_t state_get_8(state_buffer * sb) {
+    uint8_t * p = state_space(sb,1);
+    return p ? p[0] : 0;
+}
+
+int16_t state_get_16(state_buffer * sb) {
+    uint8_t * p = state_space(sb,2);
+    return p ? get_16bitLE(p) : 0;
+}
+
+int32_t state_get_32(state_buffer * sb) {
+    uint8_t * p = state_space(sb,4);
+    return p ? get_32bitLE(p) : 0;
+}
+
+off_t state_get_offset(state_buffer * sb) {
+    uint32_t low = (uint32_t)state_get_32(sb);
+    int32_t high = state_get_32(sb);
+
+    /* too big for this off_t */
+    if (sizeof(off_t) < 8 && high != 0) {
+        sb->error = 1;
+        return 0;
+    }
+    return (off_t)(((off_t)high << 16) << 16) | (off_t)low;
+}
+
+void state_get_bytes(state_buffer * sb, uint8_t * bytes, size_t length) {
+    uint8_t * p = state_space(sb,length);
+    if (p) memcpy(bytes,p,length);
+}
+
+double state_get_double(state_buffer * sb) {
+    union { double d; uint64_t u; } bits;
+    uint32_t low = (uint32_t)state_get_32(sb);
+    uint32_t high = (uint32_t)state_get_32(sb);
+
+    bits.u = ((uint64_t)high << 32) | low;
+    return bits.d;
+}
+
+void state_put_stream(state_buffer * sb, const VGMSTREAM * vgmstream) {
+    int chan;
+
+    state_put_32(sb,vgmstream->channels);
+    state_put_32(sb,vgmstream->num_samples);
+    state_put_32(sb,vgmstream->sample_rate);
+    state_put_32(sb,vgmstream->coding_type);
+    state_put_32(sb,vgmstream->layout_type);
+    state_put_32(sb,vgmstream->meta_type);
+    for (chan=0;chan<vgmstream->channels;chan++)
+        state_put_offset(sb,vgmstream->start_ch[chan].offset);
+}
+
+void state_check_stream(state_buffer * sb, const VGMSTREAM * vgmstream) {
+    int chan;
+
+    if (state_get_32(sb) != vgmstream->channels ||
+            state_get_32(sb) != vgmstream->num_samples ||
+            state_get_32(sb) != vgmstream->sample_rate ||
+            state_get_32(sb) != vgmstream->coding_type ||
+            state_get_32(sb) != vgmstream->layout_type ||
+            state_get_32(sb) != vgmstream->meta_type) {
+        sb->error = 1;
+        return;
+    }
+    for (chan=0;chan<vgmstream->channels;chan++) {
+        if (state_get_offset(sb) != vgmstream->start_ch[chan].offset)
+            sb->error = 1;
+    }
+}
+
+void state_put_channel(state_buffer * sb, const VGMSTREAMCHANNEL * ch) {
+    const struct g72x_state * g72x = &ch->g72x_state;
+    int i;
+
+    state_put_offset(sb,ch->offset);
+    state_put_offset(sb,ch->frame_header_offset);
+    state_put_32(sb,ch->samples_left_in_frame);
+
+    /* blocked layouts load coefficients with each block */
+    for (i=0;i<16;i++)
+        state_put_16(sb,ch->adpcm_coef[i]);
+    state_put_32(sb,ch->adpcm_history1_32);
+    state_put_32(sb,ch->adpcm_history2_32);
+    state_put_32(sb,ch->adpcm_history3_32);
+    state_put_32(sb,ch->adpcm_step_index);
+    state_put_32(sb,ch->adpcm_scale);
+
+    state_put_32(sb,(int32_t)g72x->yl);
+    state_put_16(sb,g72x->yu);
+    state_put_16(sb,g72x->dms);
+    state_put_16(sb,g72x->dml);
+    state_put_16(sb,g72x->ap);
+    for (i=0;i<2;i++) state_put_16(sb,g72x->a[i]);
+    for (i=0;i<6;i++) state_put_16(sb,g72x->b[i]);
+    for (i=0;i<2;i++) state_put_16(sb,g72x->pk[i]);
+    for (i=0;i<6;i++) state_put_16(sb,g72x->dq[i]);
+    for (i=0;i<2;i++) state_put_16(sb,g72x->sr[i]);
+    state_put_8(sb,(uint8_t)g72x->td);
+
+    state_put_16(sb,ch->adx_xor);
+    state_put_16(sb,ch->adx_mult);
+    state_put_16(sb,ch->adx_add);
+    state_put_8(sb,ch->bmdx_xor);
+    state_put_8(sb,ch->bmdx_add);
+    state_put_16(sb,ch->key_xor);
+}
+
+void state_get_channel(state_buffer * sb, const VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * ch) {
+    struct g72x_state * g72x = &ch->g72x_state;
+    int i;
+
+    ch->offset = state_get_offset(sb);
+    ch->frame_header_offset = state_get_offset(sb);
+    ch->samples_left_in_frame = state_get_32(sb);
+
+    for (i=0;i<16;i++)
+        ch->adpcm_coef[i] = state_get_16(sb);
+    ch->adpcm_history1_32 = state_get_32(sb);
+    ch->adpcm_history2_32 = state_get_32(sb);
+    ch->adpcm_history3_32 = state_get_32(sb);
+    ch->adpcm_step_index = state_get_32(sb);
+    ch->adpcm_scale = state_get_32(sb);
+
+    g72x->yl = state_get_32(sb);
+    g72x->yu = state_get_16(sb);
+    g72x->dms = state_get_16(sb);
+    g72x->dml = state_get_16(sb);
+    g72x->ap = state_get_16(sb);
+    for (i=0;i<2;i++) g72x->a[i] = state_get_16(sb);
+    for (i=0;i<6;i++) g72x->b[i] = state_get_16(sb);
+    for (i=0;i<2;i++) g72x->pk[i] = state_get_16(sb);
+    for (i=0;i<6;i++) g72x->dq[i] = state_get_16(sb);
+    for (i=0;i<2;i++) g72x->sr[i] = state_get_16(sb);
+    g72x->td = (char)state_get_8(sb);
+
+    ch->adx_xor = state_get_16(sb);
+    ch->adx_mult = state_get_16(sb);
+    ch->adx_add = state_get_16(sb);
+    ch->bmdx_xor = state_get_8(sb);
+    ch->bmdx_add = state_get_8(sb);
+    ch->key_xor = state_get_16(sb);
+
+    /* the IMA decoders look their step up with it, MTAF in a smaller table
+     * (AICA keeps the step itself) */
+    if (vgmstream->coding_type == coding_MTAF) {
+        if (ch->adpcm_step_index < 0 || ch->adpcm_step_index > 31)
+            sb->error = 1;
+    }
+    else if (vgmstream->coding_type != coding_AICA) {
+        if (ch->adpcm_step_index < 0 || ch->adpcm_step_index > 88)
+            sb->error = 1;
+    }
+}
+
+void state_put_position(state_buffer * sb, const VGMSTREAM * vgmstream) {
+    state_put_32(sb,vgmstream->current_sample);
+    state_put_32(sb,vgmstream->samples_into_block);
+    state_put_offset(sb,vgmstream->current_block_offset);
+    state_put_offset(sb,vgmstream->current_block_size);
+    state_put_offset(sb,vgmstream->next_block_offset);
+    state_put_32(sb,vgmstream->hit_loop);
+
+    state_put_32(sb,vgmstream->loop_sample);
+    state_put_32(sb,vgmstream->loop_samples_into_block);
+    state_put_offset(sb,vgmstream->loop_block_offset);
+    state_put_offset(sb,vgmstream->loop_block_size);
+    state_put_offset(sb,vgmstream->loop_next_block_offset);
+
+    state_put_8(sb,(uint8_t)vgmstream->get_high_nibble);
+    state_put_32(sb,vgmstream->ws_output_size);
+    state_put_32(sb,vgmstream->thpNextFrameSize);
+
+    /* the channels have the history the XA group started with, it is
+     * decoded again from there */
+    state_put_32(sb,vgmstream->xa_sector_length);
+}
+
+/* Whether samples_into_block fits the block the layout would work out from
+ * block_size, so its samples_to_do doesn't come out negative. */
+static int block_position_valid(VGMSTREAM * vgmstream, int32_t position,
+        int32_t samples_into_block, off_t block_size, int short_block) {
+    int frame_size = get_vgmstream_frame_size(vgmstream);
+    int samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+    int32_t samples_this_block;
+
+    if (samples_into_block < 0 || samples_into_block > position)
+        return 0;
+
+    if (vgmstream->layout_render == render_vgmstream_interleave) {
+        if (frame_size <= 0) return 0;
+        samples_this_block = vgmstream->interleave_block_size / frame_size * samples_per_frame;
+
+        if (short_block && vgmstream->layout_type == layout_interleave_shortblock &&
+                position - samples_into_block + samples_this_block > vgmstream->num_samples) {
+            frame_size = get_vgmstream_shortframe_size(vgmstream);
+            samples_per_frame = get_vgmstream_samples_per_shortframe(vgmstream);
+            if (frame_size <= 0) return 0;
+            samples_this_block = vgmstream->interleave_smallblock_size / frame_size * samples_per_frame;
+        }
+    }
+    else if (vgmstream->layout_render == render_vgmstream_blocked) {
+        if (block_size < 0) return 0;
+        if (frame_size == 0)
+            samples_this_block = block_size * 2 * samples_per_frame;
+        else
+            samples_this_block = block_size / frame_size * samples_per_frame;
+
+        /* XA decodes the block to xa_group, it can't be any longer */
+        if (vgmstream->coding_type == coding_XA &&
+                samples_this_block > sizeof(vgmstream->xa_group)/sizeof(sample)/vgmstream->channels)
+            return 0;
+    }
+    else if (vgmstream->layout_render == render_vgmstream_interleave_byte) {
+        samples_this_block = samples_per_frame;
+    }
+    else if (vgmstream->layout_render == render_vgmstream_interleave_sample) {
+        /* not kept, it goes by the loop points only */
+        samples_this_block = 0;
+    }
+    else {
+        return 1;
+    }
+
+    return samples_into_block <= samples_this_block;
+}
+
+/* A position the layouts can go on from. A bad one would have them count
+ * samples_written backwards, and write before the caller's buffer. Needs
+ * the loop fields set first. */
+static int position_valid(VGMSTREAM * vgmstream) {
+    int32_t end = vgmstream->num_samples;
+
+    /* for streams built outside of init_vgmstream */
+    if (!vgmstream->layout_render)
+        setup_vgmstream_layout(vgmstream);
+
+    if (vgmstream->loop_flag) {
+        if (vgmstream->loop_start_sample < 0 ||
+                vgmstream->loop_start_sample > vgmstream->loop_end_sample)
+            return 0;
+        end = vgmstream->loop_end_sample;
+    }
+
+    if (vgmstream->current_sample < 0 || vgmstream->current_sample > end)
+        return 0;
+    /* before the loop start, it stops there to save the loop */
+    if (vgmstream->loop_flag && !vgmstream->hit_loop &&
+            vgmstream->current_sample > vgmstream->loop_start_sample)
+        return 0;
+    if (!block_position_valid(vgmstream,vgmstream->current_sample,
+                vgmstream->samples_into_block,vgmstream->current_block_size,1))
+        return 0;
+
+    /* where vgmstream_do_loop puts it back */
+    if (vgmstream->loop_flag && vgmstream->hit_loop) {
+        if (vgmstream->loop_sample < 0 || vgmstream->loop_sample > end)
+            return 0;
+        /* the layouts assume the loop is not back into a short block */
+        if (!block_position_valid(vgmstream,vgmstream->loop_sample,
+                    vgmstream->loop_samples_into_block,vgmstream->loop_block_size,0))
+            return 0;
+    }
+
+    return 1;
+}
+
+void state_get_position(state_buffer * sb, VGMSTREAM * vgmstream) {
+    vgmstream->current_sample = state_get_32(sb);
+    vgmstream->samples_into_block = state_get_32(sb);
+    vgmstream->current_block_offset = state_get_offset(sb);
+    vgmstream->current_block_size = state_get_offset(sb);
+    vgmstream->next_block_offset = state_get_offset(sb);
+    vgmstream->hit_loop = state_get_32(sb);
+
+    vgmstream->loop_sample = state_get_32(sb);
+    vgmstream->loop_samples_into_block = state_get_32(sb);
+    vgmstream->loop_block_offset = state_get_offset(sb);
+    vgmstream->loop_block_size = state_get_offset(sb);
+    vgmstream->loop_next_block_offset = state_get_offset(sb);
+
+    vgmstream->get_high_nibble = (int8_t)state_get_8(sb);
+    vgmstream->ws_output_size = state_get_32(sb);
+    vgmstream->thpNextFrameSize = state_get_32(sb);
+
+    vgmstream->xa_sector_length = state_get_32(sb);
+    vgmstream->xa_group_decoded = 0;
+
+    if (!sb->error && !position_valid(vgmstream))
+        sb->error = 1;
+}
+
+/* Whole stream state, see save_vgmstream_state. */
+#define STATE_VERSION 2
+
+/* Streams that have all their state in the VGMSTREAM, and the ones with
+ * codec_data that can be put back from that: Ogg Vorbis and MPEG seek to
+ * the position, and the layouts made of other streams write theirs. */
+static int vgmstream_state_supported(VGMSTREAM * vgmstream) {
+    VGMSTREAM ** streams = NULL;
+    int stream_count = 0;
+    int i;
+
+    if (!vgmstream->codec_data)
+        return 1;
+
+#ifdef VGM_USE_VORBIS
+    if (vgmstream->coding_type==coding_ogg_vorbis)
+        return 1;
+#endif
+#ifdef VGM_USE_MPEG
+    /* not fake MPEG */
+    if (vgmstream->layout_type==layout_mpeg)
+        return 1;
+#endif
+
+    if (vgmstream->layout_type==layout_aax) {
+        /* the state is its segments' */
+        aax_codec_data *data = vgmstream->codec_data;
+        streams = data->adxs;
+        stream_count = data->segment_count;
+    }
+    else if (vgmstream->layout_type==layout_scd_int) {
+        /* the state is its substreams' */
+        scd_int_codec_data *data = vgmstream->codec_data;
+        streams = data->substreams;
+        stream_count = data->substream_count;
+    }
+    else {
+        /* AIX streams read through a streamfile that follows the AIXP
+         * chunks in order, and where it got to isn't in any VGMSTREAM */
+        return 0;
+    }
+
+    for (i=0;i<stream_count;i++) {
+        if (!vgmstream_state_supported(streams[i]))
+            return 0;
+    }
+    return 1;
+}
+
+static void put_vgmstream_state(state_buffer * sb, VGMSTREAM * vgmstream) {
+    play_config_data * play = vgmstream->play_config;
+    int i, chan;
+
+    state_put_stream(sb,vgmstream);
+
+    /* first, it changes the loop */
+    state_put_8(sb,play != NULL);
+    if (play) {
+        state_put_double(sb,play->config.loop_count);
+        state_put_double(sb,play->config.fade_seconds);
+        state_put_double(sb,play->config.fade_delay_seconds);
+        state_put_32(sb,play->config.fade_curve);
+        state_put_32(sb,play->config.ignore_loop);
+        state_put_32(sb,play->config.force_loop);
+        state_put_32(sb,play->config.play_forever);
+        state_put_32(sb,play->position);
+    }
+
+    state_put_32(sb,vgmstream->loop_flag);
+    state_put_32(sb,vgmstream->loop_start_sample);
+    state_put_32(sb,vgmstream->loop_end_sample);
+    state_put_8(sb,vgmstream->loop_ch != NULL);
+
+    state_put_position(sb,vgmstream);
+    for (chan=0;chan<vgmstream->channels;chan++)
+        state_put_channel(sb,&vgmstream->ch[chan]);
+    if (vgmstream->loop_ch) {
+        for (chan=0;chan<vgmstream->channels;chan++)
+            state_put_channel(sb,&vgmstream->loop_ch[chan]);
+    }
+
+    if (vgmstream->layout_type==layout_aax) {
+        aax_codec_data *data = vgmstream->codec_data;
+
+        state_put_32(sb,data->current_segment);
+        for (i=0;i<data->segment_count;i++)
+            put_vgmstream_state(sb,data->adxs[i]);
+    }
+    else if (vgmstream->layout_type==layout_scd_int) {
+        scd_int_codec_data *data = vgmstream->codec_data;
+
+        for (i=0;i<data->substream_count;i++)
+            put_vgmstream_state(sb,data->substreams[i]);
+    }
+}
+
+/* The play config read from a state, only put on the stream once the whole
+ * state has been read. */
+typedef struct {
+    int has_play;
+    vgmstream_play_config config;
+    int32_t position;
+} state_play;
+
+/* stops at the first error, the caller resets the stream then; play is
+ * NULL for the streams inside a layout, which never have a config */
+static void get_vgmstream_state(state_buffer * sb, VGMSTREAM * vgmstream, state_play * play) {
+    int has_play, has_loop_ch;
+    int i, chan;
+
+    state_check_stream(sb,vgmstream);
+
+    has_play = state_get_8(sb);
+    if (has_play) {
+        if (!play) {
+            sb->error = 1;
+            return;
+        }
+
+        play->has_play = 1;
+        memset(&play->config,0,sizeof(play->config));
+        play->config.loop_count = state_get_double(sb);
+        play->config.fade_seconds = state_get_double(sb);
+        play->config.fade_delay_seconds = state_get_double(sb);
+        play->config.fade_curve = (fade_curve_t)state_get_32(sb);
+        play->config.ignore_loop = state_get_32(sb);
+        play->config.force_loop = state_get_32(sb);
+        play->config.play_forever = state_get_32(sb);
+        play->position = state_get_32(sb);
+        if (sb->error) return;
+    }
+
+    vgmstream->loop_flag = state_get_32(sb);
+    vgmstream->loop_start_sample = state_get_32(sb);
+    vgmstream->loop_end_sample = state_get_32(sb);
+    has_loop_ch = state_get_8(sb);
+    if (sb->error) return;
+
+    /* the stream was opened without a loop, and one was forced */
+    if (has_loop_ch && !vgmstream->loop_ch) {
+        VGMSTREAM * start_vgmstream = vgmstream->start_vgmstream;
+
+        vgmstream->loop_ch = calloc(vgmstream->channels,sizeof(VGMSTREAMCHANNEL));
+        if (!vgmstream->loop_ch) {
+            sb->error = 1;
+            return;
+        }
+        /* so a reset doesn't lose it */
+        start_vgmstream->loop_ch = vgmstream->loop_ch;
+    }
+
+    state_get_position(sb,vgmstream);
+    for (chan=0;chan<vgmstream->channels;chan++)
+        state_get_channel(sb,vgmstream,&vgmstream->ch[chan]);
+    if (has_loop_ch) {
+        for (chan=0;chan<vgmstream->channels;chan++) {
+            state_get_channel(sb,vgmstream,&vgmstream->loop_ch[chan]);
+            /* only filled when the loop start is hit, which may have been
+             * before the state was saved */
+            vgmstream->loop_ch[chan].streamfile = vgmstream->ch[chan].streamfile;
+        }
+    }
+    if (sb->error) return;
+
+    /* the cached block and loop pass are from wherever we were */
+    if (vgmstream->block_cache)
+        vgmstream->block_cache->valid = 0;
+    reset_loop_cache(vgmstream->loop_cache);
+
+    if (vgmstream->layout_type==layout_aax) {
+        aax_codec_data *data = vgmstream->codec_data;
+
+        data->current_segment = state_get_32(sb);
+        if (data->current_segment < 0 || data->current_segment >= data->segment_count)
+            sb->error = 1;
+        for (i=0;i<data->segment_count && !sb->error;i++)
+            get_vgmstream_state(sb,data->adxs[i],NULL);
+    }
+    else if (vgmstream->layout_type==layout_scd_int) {
+        scd_int_codec_data *data = vgmstream->codec_data;
+
+        for (i=0;i<data->substream_count && !sb->error;i++)
+            get_vgmstream_state(sb,data->substreams[i],NULL);
+    }
+    else if (vgmstream->codec_data && !sb->error) {
+        /* Ogg Vorbis or MPEG, the codec goes to the position itself (or it
+         * is decoded up to it) */
+        seek_vgmstream(vgmstream,vgmstream->current_sample);
+    }
+}
+
+/* Puts the config on the stream, keeping the loop and position the state
+ * has (the ones the config gives, unless the state is from another build). */
+static int apply_state_play(VGMSTREAM * vgmstream, state_play * play) {
+    VGMSTREAM * start_vgmstream = vgmstream->start_vgmstream;
+    int loop_flag = vgmstream->loop_flag;
+    int32_t loop_start_sample = vgmstream->loop_start_sample;
+    int32_t loop_end_sample = vgmstream->loop_end_sample;
+
+    /* the first config keeps the loop it goes on as the one the stream was
+     * opened with, which the state has changed */
+    if (!vgmstream->play_config) {
+        vgmstream->loop_flag = start_vgmstream->loop_flag;
+        vgmstream->loop_start_sample = start_vgmstream->loop_start_sample;
+        vgmstream->loop_end_sample = start_vgmstream->loop_end_sample;
+    }
+
+    if (!vgmstream_set_play_config(vgmstream,&play->config))
+        return 0;
+
+    vgmstream->loop_flag = loop_flag;
+    vgmstream->loop_start_sample = loop_start_sample;
+    vgmstream->loop_end_sample = loop_end_sample;
+    set_play_position(vgmstream->play_config,play->position);
+    return 1;
+}
+
+size_t save_vgmstream_state(VGMSTREAM * vgmstream, uint8_t * buf, size_t size) {
+    state_buffer sb;
+
+    if (!vgmstream_state_supported(vgmstream))
+        return 0;
+
+    /* while replaying the channels are at the loop end, not where play is */
+    if (vgmstream->loop_cache && vgmstream->loop_cache->replaying)
+        leave_loop_cache_replay(vgmstream->loop_cache,vgmstream);
+
+    memset(&sb,0,sizeof(sb));
+    sb.buf = buf;
+    sb.size = size;
+
+    state_put_bytes(&sb,(const uint8_t *)"VGST",4);
+    state_put_32(&sb,STATE_VERSION);
+    put_vgmstream_state(&sb,vgmstream);
+
+    if (sb.error) return 0;
+    return sb.pos;
+}
+
+int load_vgmstream_state(VGMSTREAM * vgmstream, const uint8_t * buf, size_t size) {
+    state_buffer sb;
+    state_play play;
+    uint8_t magic[4];
+
+    if (!buf || !vgmstream_state_supported(vgmstream))
+        return 0;
+
+    memset(&sb,0,sizeof(sb));
+    sb.buf = (uint8_t *)buf; /* only read */
+    sb.size = size;
+
+    state_get_bytes(&sb,magic,4);
+    if (memcmp(magic,"VGST",4) != 0 || state_get_32(&sb) != STATE_VERSION)
+        sb.error = 1;
+    memset(&play,0,sizeof(play));
+    if (!sb.error)
+        get_vgmstream_state(&sb,vgmstream,&play);
+
+    if (sb.error || sb.pos != size ||
+            (play.has_play && !apply_state_play(vgmstream,&play))) {
+        reset_vgmstream(vgmstream);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,53 @@
+/*
+ * state.h - writing the decoder state to bytes and back
+ */
+
+#ifndef _STATE_H
+#define _STATE_H
+
+#include "vgmstream.h"
+
+/* Bytes the state is written to or read from. Writing with a NULL buf only
+ * counts the size. Running out of buffer (or reading something that makes
+ * no sense) sets error, and later calls do nothing. Values are written
+ * little endian. */
+typedef struct {
+    uint8_t * buf;
+    size_t size;
+    size_t pos;
+    int error;
+} state_buffer;
+
+void state_put_8(state_buffer * sb, uint8_t value);
+void state_put_16(state_buffer * sb, int16_t value);
+void state_put_32(state_buffer * sb, int32_t value);
+void state_put_offset(state_buffer * sb, off_t value);
+void state_put_bytes(state_buffer * sb, const uint8_t * bytes, size_t length);
+void state_put_double(state_buffer * sb, double value);
+
+uint8_t state_get_8(state_buffer * sb);
+int16_t state_get_16(state_buffer * sb);
+int32_t state_get_32(state_buffer * sb);
+off_t state_get_offset(state_buffer * sb);
+void state_get_bytes(state_buffer * sb, uint8_t * bytes, size_t length);
+double state_get_double(state_buffer * sb);
+
+/* What the state depends on: the format, channels and where they start. A
+ * state for another stream isn't read, state_check_stream sets error. */
+void state_put_stream(state_buffer * sb, const VGMSTREAM * vgmstream);
+void state_check_stream(state_buffer * sb, const VGMSTREAM * vgmstream);
+
+/* The fields of a channel that decoding changes, the streamfile and the
+ * ones set at init stay as they are on reading. Getting them sets error on
+ * a step index the stream's decoder has no table entry for. */
+void state_put_channel(state_buffer * sb, const VGMSTREAMCHANNEL * ch);
+void state_get_channel(state_buffer * sb, const VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * ch);
+
+/* The fields of the VGMSTREAM the layouts and decoders change: position,
+ * block and saved loop values. Not the channels. Getting them checks them
+ * against num_samples, the loop points (set them first) and the block, and
+ * sets error on a position the layouts can't go on from. */
+void state_put_position(state_buffer * sb, const VGMSTREAM * vgmstream);
+void state_get_position(state_buffer * sb, VGMSTREAM * vgmstream);
+
+#endif
@@ -9,6 +9,11 @@
 #include "meta/meta.h"
 #include "layout/layout.h"
 #include "coding/coding.h"
+#include "kernels.h"
+#include "workpool.h"
+#include "seek.h"
+#include "loop_cache.h"
+#include "play.h"
 
 /*
  * List of functions that will recognize files. These should correspond pretty
@@ -332,6 +337,9 @@ VGMSTREAM * (*init_vgmstream_fcns[])(STREAMFILE *streamFile) = {
 
 #define INIT_VGMSTREAM_FCNS (sizeof(init_vgmstream_fcns)/sizeof(init_vgmstream_fcns[0]))
 
+static void setup_vgmstream_block_cache(VGMSTREAM * vgmstream);
+static void setup_vgmstream_parallel_decode(VGMSTREAM * vgmstream);
+
 /* internal version with all parameters */
 VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int do_dfs) {
     int i;
@@ -339,6 +347,9 @@ VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int do_dfs) {
     if (!streamFile)
         return NULL;
 
+    /* pick the decode kernels for this CPU before anything is decoded */
+    init_kernels();
+
     /* try a series of formats, see which works */
     for (i=0;i<INIT_VGMSTREAM_FCNS;i++) {
         VGMSTREAM * vgmstream = (init_vgmstream_fcns[i])(streamFile);
@@ -371,6 +382,14 @@ VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int do_dfs) {
                 try_dual_file_stereo(vgmstream, streamFile);
             }
 
+            /* pick the layout operations before the start state is saved */
+            setup_vgmstream_layout(vgmstream);
+
+            /* same for the block cache and parallel decode data, so all
+             * copies share them */
+            setup_vgmstream_block_cache(vgmstream);
+            setup_vgmstream_parallel_decode(vgmstream);
+
             /* save start things so we can restart for seeking */
             /* copy the channels */
             memcpy(vgmstream->start_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
@@ -402,8 +421,18 @@ VGMSTREAM * init_vgmstream_from_STREAMFILE(STREAMFILE *streamFile) {
 /* Reset a VGMSTREAM to its state at the start of playback.
  * Note that this does not reset the constituent STREAMFILES. */
 void reset_vgmstream(VGMSTREAM * vgmstream) {
+    /* the seek checkpoints, loop cache and play config are made after init */
+    struct seek_index_data * seek_index = vgmstream->seek_index;
+    struct loop_cache_data * loop_cache = vgmstream->loop_cache;
+    struct play_config_data * play_config = vgmstream->play_config;
+
     /* copy the vgmstream back into itself */
     memcpy(vgmstream,vgmstream->start_vgmstream,sizeof(VGMSTREAM));
+    vgmstream->seek_index = seek_index;
+    vgmstream->loop_cache = loop_cache;
+    vgmstream->play_config = play_config;
+    reset_loop_cache(loop_cache);
+    set_play_position(play_config,0);
 
     /* copy the initial channels */
     memcpy(vgmstream->ch,vgmstream->start_ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
@@ -569,6 +598,37 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
     int i,j;
     if (!vgmstream) return;
 
+    if (vgmstream->block_cache) {
+        free(vgmstream->block_cache->buffer);
+        free(vgmstream->block_cache->ch_saved);
+        free(vgmstream->block_cache->ch_after);
+        free(vgmstream->block_cache);
+        vgmstream->block_cache = NULL;
+    }
+
+    if (vgmstream->parallel_decode) {
+        if (vgmstream->parallel_decode->files) {
+            for (i=0;i<vgmstream->channels;i++) {
+                if (vgmstream->parallel_decode->files[i])
+                    close_streamfile(vgmstream->parallel_decode->files[i]);
+            }
+        }
+        free(vgmstream->parallel_decode->files);
+        free(vgmstream->parallel_decode->buffer);
+        free(vgmstream->parallel_decode->channel_buffers);
+        free(vgmstream->parallel_decode);
+        vgmstream->parallel_decode = NULL;
+    }
+
+    free_seek_index(vgmstream->seek_index);
+    vgmstream->seek_index = NULL;
+
+    free_loop_cache(vgmstream->loop_cache);
+    vgmstream->loop_cache = NULL;
+
+    free_play_config(vgmstream->play_config);
+    vgmstream->play_config = NULL;
+
 #ifdef VGM_USE_VORBIS
     if (vgmstream->coding_type==coding_ogg_vorbis) {
         ogg_vorbis_codec_data *data = vgmstream->codec_data;
@@ -591,6 +651,7 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
 
         if (data) {
             mpg123_delete(data->m);
+            free(data->frame_offsets);
             free(vgmstream->codec_data);
             vgmstream->codec_data = NULL;
             /* The astute reader will note that a call to mpg123_exit is never
@@ -654,8 +715,8 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
                 for (i=0;i<data->segment_count*data->stream_count;i++) {
 
                     /* note that the AIX close_streamfile won't do anything but
-                     * deallocate itself, there is only one open file and that
-                     * is in vgmstream->ch[0].streamfile  */
+                     * deallocate itself, the open files (one per stream)
+                     * are in vgmstream->ch[].streamfile  */
                     close_vgmstream(data->adxs[i]);
                 }
                 free(data->adxs);
@@ -663,6 +724,12 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
             if (data->sample_counts) {
                 free(data->sample_counts);
             }
+            if (data->channel_buffers) {
+                int i;
+                for (i=0;i<vgmstream->channels;i++)
+                    free(data->channel_buffers[i]);
+                free(data->channel_buffers);
+            }
 
             free(data);
         }
@@ -718,14 +785,18 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
                 for (i=0;i<data->substream_count;i++) {
 
                     /* note that the scd_int close_streamfile won't do anything 
-                     * but deallocate itself, there is only one open file and
-                     * that is in vgmstream->ch[0].streamfile  */
+                     * but deallocate itself, the open files (one per
+                     * substream) are in vgmstream->ch[].streamfile  */
                     close_vgmstream(data->substreams[i]);
-                    close_streamfile(data->intfiles[i]);
+                    if (data->intfiles && data->intfiles[i])
+                        close_streamfile(data->intfiles[i]);
+                    if (data->buffers)
+                        free(data->buffers[i]);
                 }
-                free(data->substreams);
-                free(data->intfiles);
             }
+            free(data->substreams);
+            free(data->intfiles);
+            free(data->buffers);
 
             free(data);
         }
@@ -764,67 +835,261 @@ int32_t get_vgmstream_play_samples(double looptimes, double fadeseconds, double
     } else return vgmstream->num_samples;
 }
 
-void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
-    switch (vgmstream->layout_type) {
-        case layout_interleave:
-        case layout_interleave_shortblock:
-            render_vgmstream_interleave(buffer,sample_count,vgmstream);
-            break;
+/*
+ * List of layouts with their render function and, for blocked layouts, the
+ * function that sets up the next block. Looked up once at init so rendering
+ * and block transitions don't have to switch on the layout.
+ */
+typedef struct {
+    layout_t layout_type;
+    void (*render)(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+    void (*block_update)(off_t block_offset, VGMSTREAM * vgmstream);
+} layout_ops;
+
+static const layout_ops layout_ops_list[] = {
+    {layout_none,               render_vgmstream_nolayout,      NULL},
+    {layout_interleave,         render_vgmstream_interleave,    NULL},
+    {layout_interleave_shortblock, render_vgmstream_interleave, NULL},
+    {layout_interleave_byte,    render_vgmstream_interleave_byte, NULL},
+    {layout_dtk_interleave,     render_vgmstream_nolayout,      NULL},
 #ifdef VGM_USE_VORBIS
-        case layout_ogg_vorbis:
+    {layout_ogg_vorbis,         render_vgmstream_nolayout,      NULL},
 #endif
 #ifdef VGM_USE_MPEG
-        case layout_fake_mpeg:
-        case layout_mpeg:
+    {layout_fake_mpeg,          render_vgmstream_nolayout,      NULL},
+    {layout_mpeg,               render_vgmstream_nolayout,      NULL},
 #endif
-        case layout_dtk_interleave:
-        case layout_none:
-            render_vgmstream_nolayout(buffer,sample_count,vgmstream);
-            break;
-		case layout_mxch_blocked:
-        case layout_ast_blocked:
-        case layout_halpst_blocked:
-        case layout_xa_blocked:
-        case layout_ea_blocked:
-        case layout_eacs_blocked:
-        case layout_caf_blocked:
-        case layout_wsi_blocked:
-        case layout_str_snds_blocked:
-        case layout_ws_aud_blocked:
-        case layout_matx_blocked:
-        case layout_de2_blocked:
-        case layout_vs_blocked:
-        case layout_emff_ps2_blocked:
-        case layout_emff_ngc_blocked:
-        case layout_gsb_blocked:
-        case layout_xvas_blocked:
-        case layout_thp_blocked:
-        case layout_filp_blocked:
-        case layout_ivaud_blocked:
-        case layout_psx_mgav_blocked:
-        case layout_ps2_adm_blocked:
-        case layout_dsp_bdsp_blocked:
-		case layout_tra_blocked:
-		case layout_ps2_iab_blocked:
-		case layout_ps2_strlr_blocked:
-            render_vgmstream_blocked(buffer,sample_count,vgmstream);
-            break;
-        case layout_interleave_byte:
-            render_vgmstream_interleave_byte(buffer,sample_count,vgmstream);
-            break;
-        case layout_acm:
-        case layout_mus_acm:
-            render_vgmstream_mus_acm(buffer,sample_count,vgmstream);
-            break;
-        case layout_aix:
-            render_vgmstream_aix(buffer,sample_count,vgmstream);
-            break;
-        case layout_aax:
-            render_vgmstream_aax(buffer,sample_count,vgmstream);
-            break;
-        case layout_scd_int:
-            render_vgmstream_scd_int(buffer,sample_count,vgmstream);
+    {layout_ast_blocked,        render_vgmstream_blocked,       ast_block_update},
+    {layout_mxch_blocked,       render_vgmstream_blocked,       mxch_block_update},
+    {layout_halpst_blocked,     render_vgmstream_blocked,       halpst_block_update},
+    {layout_xa_blocked,         render_vgmstream_blocked,       xa_block_update},
+    {layout_ea_blocked,         render_vgmstream_blocked,       ea_block_update},
+    {layout_eacs_blocked,       render_vgmstream_blocked,       eacs_block_update},
+    {layout_caf_blocked,        render_vgmstream_blocked,       caf_block_update},
+    {layout_wsi_blocked,        render_vgmstream_blocked,       wsi_block_update},
+    {layout_str_snds_blocked,   render_vgmstream_blocked,       str_snds_block_update},
+    {layout_ws_aud_blocked,     render_vgmstream_blocked,       ws_aud_block_update},
+    {layout_matx_blocked,       render_vgmstream_blocked,       matx_block_update},
+    {layout_de2_blocked,        render_vgmstream_blocked,       de2_block_update},
+    {layout_vs_blocked,         render_vgmstream_blocked,       vs_block_update},
+    {layout_emff_ps2_blocked,   render_vgmstream_blocked,       emff_ps2_block_update},
+    {layout_emff_ngc_blocked,   render_vgmstream_blocked,       emff_ngc_block_update},
+    {layout_gsb_blocked,        render_vgmstream_blocked,       gsb_block_update},
+    {layout_xvas_blocked,       render_vgmstream_blocked,       xvas_block_update},
+    {layout_thp_blocked,        render_vgmstream_blocked,       thp_block_update},
+    {layout_filp_blocked,       render_vgmstream_blocked,       filp_block_update},
+    {layout_ivaud_blocked,      render_vgmstream_blocked,       ivaud_block_update},
+    {layout_psx_mgav_blocked,   render_vgmstream_blocked,       psx_mgav_block_update},
+    {layout_ps2_adm_blocked,    render_vgmstream_blocked,       ps2_adm_block_update},
+    {layout_dsp_bdsp_blocked,   render_vgmstream_blocked,       dsp_bdsp_block_update},
+    {layout_tra_blocked,        render_vgmstream_blocked,       tra_block_update},
+    {layout_ps2_iab_blocked,    render_vgmstream_blocked,       ps2_iab_block_update},
+    {layout_ps2_strlr_blocked,  render_vgmstream_blocked,       ps2_strlr_block_update},
+    {layout_acm,                render_vgmstream_mus_acm,       NULL},
+    {layout_mus_acm,            render_vgmstream_mus_acm,       NULL},
+    {layout_aix,                render_vgmstream_aix,           NULL},
+    {layout_aax,                render_vgmstream_aax,           NULL},
+    {layout_scd_int,            render_vgmstream_scd_int,       NULL},
+};
+
+#define LAYOUT_OPS_COUNT (sizeof(layout_ops_list)/sizeof(layout_ops_list[0]))
+
+/* PCM interleaved one sample at a time, with the channels next to each other
+ * in the same file. The interleave layout would go one block (one sample) at
+ * a time, this can be rendered as sample-interleaved data. */
+static int vgmstream_is_sample_interleaved(VGMSTREAM * vgmstream) {
+    int chan;
+
+    if (vgmstream->layout_type != layout_interleave)
+        return 0;
+
+    switch (vgmstream->coding_type) {
+        case coding_PCM16LE:
+        case coding_PCM16BE:
+        case coding_PCM8:
+        case coding_PCM8_U:
             break;
+        default:
+            return 0;
+    }
+
+    if (vgmstream->interleave_block_size != get_vgmstream_frame_size(vgmstream))
+        return 0;
+
+    for (chan=1;chan<vgmstream->channels;chan++) {
+        if (vgmstream->ch[chan].streamfile != vgmstream->ch[0].streamfile ||
+                vgmstream->ch[chan].offset != vgmstream->ch[0].offset+chan*vgmstream->interleave_block_size)
+            return 0;
+    }
+
+    return 1;
+}
+
+void setup_vgmstream_layout(VGMSTREAM * vgmstream) {
+    int i;
+
+    vgmstream->layout_render = NULL;
+    vgmstream->block_update = NULL;
+
+    if (vgmstream_is_sample_interleaved(vgmstream)) {
+        vgmstream->layout_render = render_vgmstream_interleave_sample;
+        return;
+    }
+
+    for (i=0;i<LAYOUT_OPS_COUNT;i++) {
+        if (layout_ops_list[i].layout_type == vgmstream->layout_type) {
+            vgmstream->layout_render = layout_ops_list[i].render;
+            vgmstream->block_update = layout_ops_list[i].block_update;
+            return;
+        }
+    }
+}
+
+void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    /* for streams built outside of init_vgmstream (sub-streams and such) */
+    if (!vgmstream->layout_render)
+        setup_vgmstream_layout(vgmstream);
+
+    if (!vgmstream->layout_render)
+        return;
+
+    if (vgmstream->loop_cache)
+        render_vgmstream_loop_cached(buffer,sample_count,vgmstream);
+    else
+        vgmstream->layout_render(buffer,sample_count,vgmstream);
+}
+
+/* Codecs that can write float output themselves, in layouts that only
+ * write to the buffer through decode_vgmstream. */
+static int vgmstream_decodes_float(VGMSTREAM * vgmstream) {
+    if (vgmstream->layout_render != render_vgmstream_nolayout &&
+            vgmstream->layout_render != render_vgmstream_interleave)
+        return 0;
+    /* replayed samples are 16-bit */
+    if (vgmstream->loop_cache)
+        return 0;
+
+    switch (vgmstream->coding_type) {
+#ifdef VGM_USE_VORBIS
+        case coding_ogg_vorbis:
+#endif
+        case coding_PSX:
+        case coding_PSX_badflags:
+        case coding_invert_PSX:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+#define FLOAT_RENDER_BUFFER_SIZE 0x2000
+
+void render_vgmstream_float(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    const vgmstream_kernels * kernels = get_kernels();
+    sample tmpbuf[FLOAT_RENDER_BUFFER_SIZE];
+    int32_t max_count;
+
+    if (!vgmstream->layout_render)
+        setup_vgmstream_layout(vgmstream);
+
+    if (vgmstream_decodes_float(vgmstream)) {
+        /* the layout still wants a sample buffer, but won't touch it */
+        vgmstream->float_buffer = buffer;
+        render_vgmstream((sample *)buffer,sample_count,vgmstream);
+        vgmstream->float_buffer = NULL;
+        return;
+    }
+
+    /* a sample of every channel has to fit, only bad headers say more */
+    if (vgmstream->channels > FLOAT_RENDER_BUFFER_SIZE) {
+        memset(buffer,0,(size_t)sample_count*vgmstream->channels*sizeof(float));
+        return;
+    }
+
+    /* render 16-bit in pieces and convert */
+    max_count = FLOAT_RENDER_BUFFER_SIZE / vgmstream->channels;
+    while (sample_count > 0) {
+        int32_t count = sample_count > max_count ? max_count : sample_count;
+
+        render_vgmstream(tmpbuf,count,vgmstream);
+        kernels->to_float(buffer,tmpbuf,count*vgmstream->channels);
+
+        buffer += count*vgmstream->channels;
+        sample_count -= count;
+    }
+}
+
+/* Codecs that can write each channel to its own buffer (see CHANNEL_OUTBUF),
+ * in layouts that only write to the buffer through decode_vgmstream. */
+static int vgmstream_decodes_planar(VGMSTREAM * vgmstream) {
+    if (vgmstream->layout_render != render_vgmstream_nolayout &&
+            vgmstream->layout_render != render_vgmstream_interleave)
+        return 0;
+    if (vgmstream->block_cache || vgmstream->loop_cache)
+        return 0;
+
+    switch (vgmstream->coding_type) {
+        case coding_CRI_ADX:
+        case coding_CRI_ADX_enc_8:
+        case coding_CRI_ADX_enc_9:
+        case coding_NGC_DSP:
+        case coding_PCM16LE:
+        case coding_PCM16BE:
+        case coding_PCM8:
+        case coding_PCM8_U:
+        case coding_PSX:
+        case coding_PSX_badflags:
+        case coding_invert_PSX:
+        case coding_DVI_IMA:
+        case coding_INT_DVI_IMA:
+        case coding_IMA:
+        case coding_INT_IMA:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+#define PLANAR_RENDER_BUFFER_SIZE 0x2000
+/* channels that can be split from the buffer, at least 0x20 samples each */
+#define PLANAR_RENDER_MAX_CHANNELS 0x100
+
+void render_vgmstream_planar(sample ** channels, int32_t sample_count, VGMSTREAM * vgmstream) {
+    const vgmstream_kernels * kernels = get_kernels();
+    sample tmpbuf[PLANAR_RENDER_BUFFER_SIZE];
+    sample * outbufs[PLANAR_RENDER_MAX_CHANNELS];
+    int32_t max_count, done;
+    int chan;
+
+    if (!vgmstream->layout_render)
+        setup_vgmstream_layout(vgmstream);
+
+    if (vgmstream_decodes_planar(vgmstream)) {
+        /* the layout still wants a sample buffer, but won't touch it */
+        vgmstream->planar_buffers = channels;
+        render_vgmstream(channels[0],sample_count,vgmstream);
+        vgmstream->planar_buffers = NULL;
+        return;
+    }
+
+    /* only bad headers say more, the caller still gets defined samples */
+    if (vgmstream->channels > PLANAR_RENDER_MAX_CHANNELS) {
+        for (chan=0;chan<vgmstream->channels;chan++)
+            memset(channels[chan],0,sample_count*sizeof(sample));
+        return;
+    }
+
+    /* render interleaved in pieces and split */
+    max_count = PLANAR_RENDER_BUFFER_SIZE / vgmstream->channels;
+    for (done=0;done<sample_count;) {
+        int32_t count = sample_count-done > max_count ? max_count : sample_count-done;
+
+        render_vgmstream(tmpbuf,count,vgmstream);
+        for (chan=0;chan<vgmstream->channels;chan++)
+            outbufs[chan] = channels[chan]+done;
+        kernels->deinterleave(outbufs,tmpbuf,vgmstream->channels,count);
+
+        done += count;
     }
 }
 
@@ -1056,14 +1321,375 @@ void decode_vgmstream_mem(VGMSTREAM * vgmstream, int samples_written, int sample
     }
 }
 
+/* Block codecs with a header per block decode the whole block of every
+ * channel at once into the block cache, calls inside the block are served
+ * from there. */
+static void setup_vgmstream_block_cache(VGMSTREAM * vgmstream) {
+    block_cache_data * cache = NULL;
+    int32_t block_samples;
+
+    switch (vgmstream->coding_type) {
+        case coding_MSADPCM:
+        case coding_MS_IMA:
+        case coding_APPLE_IMA4:
+            break;
+        case coding_XBOX:
+            /* the decoder only handles 1 or 2 channels per frame */
+            if (vgmstream->channels > 2) return;
+            break;
+        default:
+            return;
+    }
+
+    block_samples = get_vgmstream_samples_per_frame(vgmstream);
+    if (block_samples <= 0) return;
+
+    cache = calloc(1,sizeof(block_cache_data));
+    if (!cache) goto fail;
+    cache->buffer = calloc(block_samples*vgmstream->channels,sizeof(sample));
+    if (!cache->buffer) goto fail;
+    cache->ch_saved = calloc(vgmstream->channels,sizeof(VGMSTREAMCHANNEL));
+    if (!cache->ch_saved) goto fail;
+    cache->ch_after = calloc(vgmstream->channels,sizeof(VGMSTREAMCHANNEL));
+    if (!cache->ch_after) goto fail;
+    cache->block_samples = block_samples;
+
+    vgmstream->block_cache = cache;
+    return;
+
+    /* no cache is not an error, decoding just goes the slow way */
+fail:
+    if (cache) {
+        free(cache->buffer);
+        free(cache->ch_saved);
+        free(cache->ch_after);
+        free(cache);
+    }
+}
+
+static void decode_vgmstream_coding(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer);
+
+static void decode_vgmstream_cached(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    block_cache_data * cache = vgmstream->block_cache;
+    int32_t first_sample = vgmstream->samples_into_block % cache->block_samples;
+    int32_t block_start = vgmstream->samples_into_block - first_sample;
+    size_t ch_size = sizeof(VGMSTREAMCHANNEL)*vgmstream->channels;
+
+    if (!cache->valid || cache->block_start != block_start ||
+            cache->offset != vgmstream->ch[0].offset) {
+        /* the block header resets the decoder, so decode from the start
+         * of the block and go back to the current state */
+        memcpy(cache->ch_saved,vgmstream->ch,ch_size);
+        vgmstream->samples_into_block = block_start;
+
+        decode_vgmstream_coding(vgmstream,0,cache->block_samples,cache->buffer);
+
+        memcpy(cache->ch_after,vgmstream->ch,ch_size);
+        memcpy(vgmstream->ch,cache->ch_saved,ch_size);
+        vgmstream->samples_into_block = block_start + first_sample;
+
+        cache->valid = 1;
+        cache->block_start = block_start;
+        cache->offset = vgmstream->ch[0].offset;
+    }
+
+    memcpy(buffer+samples_written*vgmstream->channels,
+            cache->buffer+first_sample*vgmstream->channels,
+            samples_to_do*vgmstream->channels*sizeof(sample));
+
+    /* leave the channels as the decoder would after the block */
+    if (first_sample+samples_to_do >= cache->block_samples)
+        memcpy(vgmstream->ch,cache->ch_after,ch_size);
+}
+
+/* Codecs where each channel only touches its own VGMSTREAMCHANNEL, so the
+ * channels can be decoded by different threads. */
+static int vgmstream_decodes_channels_apart(VGMSTREAM * vgmstream) {
+    switch (vgmstream->coding_type) {
+        case coding_CRI_ADX:
+        case coding_CRI_ADX_enc_8:
+        case coding_CRI_ADX_enc_9:
+        case coding_NGC_DSP:
+        case coding_PSX:
+        case coding_PSX_badflags:
+        case coding_invert_PSX:
+        case coding_DVI_IMA:
+        case coding_INT_DVI_IMA:
+        case coding_IMA:
+        case coding_INT_IMA:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void decode_vgmstream_channel(VGMSTREAM * vgmstream, int chan, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    VGMSTREAMCHANNEL * stream = &vgmstream->ch[chan];
+
+    switch (vgmstream->coding_type) {
+        case coding_CRI_ADX:
+            decode_adx(stream,outbuf,channelspacing,first_sample,samples_to_do);
+            break;
+        case coding_CRI_ADX_enc_8:
+        case coding_CRI_ADX_enc_9:
+            decode_adx_enc(stream,outbuf,channelspacing,first_sample,samples_to_do);
+            break;
+        case coding_NGC_DSP:
+            decode_ngc_dsp(stream,outbuf,channelspacing,first_sample,samples_to_do);
+            break;
+        case coding_PSX:
+        case coding_PSX_badflags:
+        case coding_invert_PSX:
+            decode_psx_channel(vgmstream,chan,outbuf,channelspacing,first_sample,samples_to_do);
+            break;
+        case coding_DVI_IMA:
+        case coding_INT_DVI_IMA:
+            decode_dvi_ima(stream,outbuf,channelspacing,first_sample,samples_to_do);
+            break;
+        case coding_IMA:
+        case coding_INT_IMA:
+            decode_ima(stream,outbuf,channelspacing,first_sample,samples_to_do);
+            break;
+        default:
+            break;
+    }
+}
+
+/* decode calls with at least this many samples (times channels) are split
+ * between threads, 0 never splits */
+static int32_t parallel_decode_threshold = PARALLEL_DECODE_THRESHOLD;
+
+void vgmstream_set_parallel_threshold(int32_t channel_samples) {
+    parallel_decode_threshold = channel_samples;
+}
+
+int vgmstream_parallel_wanted(int32_t channel_samples) {
+    return parallel_decode_threshold > 0 && channel_samples >= parallel_decode_threshold;
+}
+
+/* Give each channel that shares its STREAMFILE with an earlier one a file
+ * of its own, as a STREAMFILE's buffer can't be read from two threads.
+ * Returns NULL if one can't be opened. */
+static STREAMFILE ** open_channel_streamfiles(VGMSTREAM * vgmstream) {
+    STREAMFILE ** files = NULL;
+    char filename[260];
+    int i, j;
+
+    files = calloc(vgmstream->channels,sizeof(STREAMFILE *));
+    if (!files) return NULL;
+
+    for (i=1;i<vgmstream->channels;i++) {
+        STREAMFILE * shared = vgmstream->ch[i].streamfile;
+
+        for (j=0;j<i;j++) {
+            if (vgmstream->ch[j].streamfile == shared)
+                break;
+        }
+        if (j == i)
+            continue;
+
+        /* each channel only reads its own part of the interleave */
+        shared->get_name(shared,filename,sizeof(filename));
+        files[i] = shared->open(shared,filename,STREAMFILE_DEFAULT_BUFFER_SIZE*vgmstream->channels);
+        if (!files[i]) goto fail;
+    }
+
+    return files;
+
+fail:
+    for (i=0;i<vgmstream->channels;i++) {
+        if (files[i])
+            close_streamfile(files[i]);
+    }
+    free(files);
+    return NULL;
+}
+
+/* Streams whose channels can be decoded apart can be decoded in parallel
+ * if there are threads to decode them with. The buffers and files it needs
+ * are only made once a decode call is big enough to use them. */
+static void setup_vgmstream_parallel_decode(VGMSTREAM * vgmstream) {
+    if (vgmstream->channels < 2 || vgmstream->skip_last_channel)
+        return;
+    if (!vgmstream_decodes_channels_apart(vgmstream))
+        return;
+
+    /* these render their sub-streams, not through decode_vgmstream */
+    if (vgmstream->layout_type == layout_aix ||
+            vgmstream->layout_type == layout_aax ||
+            vgmstream->layout_type == layout_scd_int)
+        return;
+
+    if (!get_workpool())
+        return;
+
+    /* decoding just stays on one thread */
+    vgmstream->parallel_decode = calloc(1,sizeof(parallel_decode_data));
+}
+
+/* Makes a buffer to decode each channel into and a file for each channel
+ * to read from, the first time. Returns 0 if they couldn't be made, then
+ * decoding stays on one thread. */
+static int parallel_decode_ready(VGMSTREAM * vgmstream) {
+    parallel_decode_data * data = vgmstream->parallel_decode;
+
+    if (data->ready)
+        return data->ready > 0;
+
+    data->ready = -1;
+    data->buffer = calloc(PARALLEL_DECODE_SAMPLES*vgmstream->channels,sizeof(sample));
+    if (!data->buffer) goto fail;
+    data->channel_buffers = calloc(vgmstream->channels,sizeof(sample *));
+    if (!data->channel_buffers) goto fail;
+    data->files = open_channel_streamfiles(vgmstream);
+    if (!data->files) goto fail;
+
+    data->ready = 1;
+    return 1;
+
+fail:
+    free(data->buffer);
+    free(data->channel_buffers);
+    data->buffer = NULL;
+    data->channel_buffers = NULL;
+    return 0;
+}
+
+/* The decoders don't go past the frame they start in, so each channel
+ * goes a frame at a time, and through the interleave blocks like the
+ * layout does. */
+static void decode_channel_task(void * arg, int chan) {
+    VGMSTREAM * vgmstream = arg;
+    parallel_decode_data * data = vgmstream->parallel_decode;
+    STREAMFILE * shared = vgmstream->ch[chan].streamfile;
+    int samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+    int32_t samples_into_block = data->first_sample;
+    int32_t done = 0;
+
+    /* only while decoding, the stream keeps the shared one */
+    if (data->files[chan])
+        vgmstream->ch[chan].streamfile = data->files[chan];
+
+    while (done < data->samples_to_do) {
+        int32_t samples_to_do = data->samples_to_do-done;
+
+        if (samples_per_frame > 1 && samples_into_block%samples_per_frame+samples_to_do > samples_per_frame)
+            samples_to_do = samples_per_frame-samples_into_block%samples_per_frame;
+        if (data->block_stride && samples_into_block+samples_to_do > data->samples_this_block)
+            samples_to_do = data->samples_this_block-samples_into_block;
+
+        decode_vgmstream_channel(vgmstream,chan,data->channel_buffers[chan]+done,1,
+                samples_into_block,samples_to_do);
+        done += samples_to_do;
+        samples_into_block += samples_to_do;
+
+        if (data->block_stride && samples_into_block == data->samples_this_block) {
+            vgmstream->ch[chan].offset += data->block_stride;
+            samples_into_block = 0;
+        }
+    }
+
+    vgmstream->ch[chan].streamfile = shared;
+}
+
+/* each channel decodes on its own thread to a contiguous buffer, which is
+ * either the caller's planar buffer or ours, interleaved afterwards */
+static void decode_vgmstream_parallel(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer,
+        int32_t samples_this_block, off_t block_stride) {
+    const vgmstream_kernels * kernels = get_kernels();
+    parallel_decode_data * data = vgmstream->parallel_decode;
+    workpool * pool = get_workpool();
+    int32_t done, count;
+    int chan;
+
+    data->samples_this_block = samples_this_block;
+    data->block_stride = block_stride;
+
+    if (vgmstream->planar_buffers) {
+        for (chan=0;chan<vgmstream->channels;chan++)
+            data->channel_buffers[chan] = vgmstream->planar_buffers[chan]+samples_written;
+        data->first_sample = vgmstream->samples_into_block;
+        data->samples_to_do = samples_to_do;
+        workpool_run(pool,decode_channel_task,vgmstream,vgmstream->channels);
+        return;
+    }
+
+    for (chan=0;chan<vgmstream->channels;chan++)
+        data->channel_buffers[chan] = data->buffer+chan*PARALLEL_DECODE_SAMPLES;
+
+    data->first_sample = vgmstream->samples_into_block;
+    for (done=0;done<samples_to_do;done+=count) {
+        count = samples_to_do-done;
+        if (count > PARALLEL_DECODE_SAMPLES) count = PARALLEL_DECODE_SAMPLES;
+
+        data->samples_to_do = count;
+        workpool_run(pool,decode_channel_task,vgmstream,vgmstream->channels);
+
+        kernels->interleave(buffer+(samples_written+done)*vgmstream->channels,
+                data->channel_buffers,vgmstream->channels,count);
+
+        data->first_sample += count;
+        if (block_stride)
+            data->first_sample %= samples_this_block;
+    }
+}
+
+int32_t decode_vgmstream_span(VGMSTREAM * vgmstream, int samples_written, int32_t sample_count, sample * buffer,
+        int32_t samples_this_block, off_t block_stride) {
+    if (!vgmstream->parallel_decode || vgmstream->float_buffer || vgmstream->block_cache)
+        return 0;
+
+    /* up to the next loop point, the layout does the loop */
+    if (vgmstream->loop_flag) {
+        if (!vgmstream->hit_loop && vgmstream->current_sample < vgmstream->loop_start_sample &&
+                sample_count > vgmstream->loop_start_sample-vgmstream->current_sample)
+            sample_count = vgmstream->loop_start_sample-vgmstream->current_sample;
+        if (vgmstream->current_sample < vgmstream->loop_end_sample &&
+                sample_count > vgmstream->loop_end_sample-vgmstream->current_sample)
+            sample_count = vgmstream->loop_end_sample-vgmstream->current_sample;
+    }
+
+    if (sample_count <= 0 || !vgmstream_parallel_wanted(sample_count*vgmstream->channels))
+        return 0;
+    if (!parallel_decode_ready(vgmstream))
+        return 0;
+
+    decode_vgmstream_parallel(vgmstream,samples_written,sample_count,buffer,samples_this_block,block_stride);
+
+    vgmstream->current_sample += sample_count;
+    vgmstream->samples_into_block += sample_count;
+    if (block_stride)
+        vgmstream->samples_into_block %= samples_this_block;
+    return sample_count;
+}
+
 void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    if (vgmstream->block_cache)
+        decode_vgmstream_cached(vgmstream,samples_written,samples_to_do,buffer);
+    else if (vgmstream->parallel_decode && !vgmstream->float_buffer &&
+            vgmstream_parallel_wanted(samples_to_do*vgmstream->channels) &&
+            parallel_decode_ready(vgmstream))
+        decode_vgmstream_parallel(vgmstream,samples_written,samples_to_do,buffer,0,0);
+    else
+        decode_vgmstream_coding(vgmstream,samples_written,samples_to_do,buffer);
+}
+
+/* Where decoders that work a channel at a time write channel chan, and the
+ * distance between its samples: interleaved in buffer, or contiguous in
+ * planar_buffers while in render_vgmstream_planar. */
+#define CHANNEL_OUTBUF(chan) (vgmstream->planar_buffers ? \
+        vgmstream->planar_buffers[chan]+samples_written : \
+        buffer+samples_written*vgmstream->channels+(chan))
+#define CHANNEL_SPACING (vgmstream->planar_buffers ? 1 : vgmstream->channels)
+
+static void decode_vgmstream_coding(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
     int chan;
 
     switch (vgmstream->coding_type) {
         case coding_CRI_ADX:
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_adx(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_adx(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
 
@@ -1071,27 +1697,33 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
         case coding_CRI_ADX_enc_8:
         case coding_CRI_ADX_enc_9:
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_adx_enc(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_adx_enc(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
 
             break;
         case coding_NGC_DSP:
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_ngc_dsp(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_ngc_dsp(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
             break;
         case coding_PCM16LE:
+            if (!vgmstream->planar_buffers && decode_pcm_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_pcm16LE(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_pcm16LE(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
             break;
         case coding_PCM16LE_int:
+            if (decode_pcm_int_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
                 decode_pcm16LE_int(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
                         vgmstream->channels,vgmstream->samples_into_block,
@@ -1099,6 +1731,9 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             }
             break;
         case coding_PCM16LE_XOR_int:
+            if (decode_pcm_int_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
                 decode_pcm16LE_XOR_int(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
                         vgmstream->channels,vgmstream->samples_into_block,
@@ -1106,27 +1741,39 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             }
             break;
         case coding_PCM16BE:
+            if (!vgmstream->planar_buffers && decode_pcm_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_pcm16BE(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_pcm16BE(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
             break;
         case coding_PCM8:
+            if (!vgmstream->planar_buffers && decode_pcm_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_pcm8(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_pcm8(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
             break;
         case coding_PCM8_U:
+            if (!vgmstream->planar_buffers && decode_pcm_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_pcm8_unsigned(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_pcm8_unsigned(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
             break;
         case coding_PCM8_int:
+            if (decode_pcm_int_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
                 decode_pcm8_int(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
                         vgmstream->channels,vgmstream->samples_into_block,
@@ -1134,6 +1781,9 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             }
             break;
         case coding_PCM8_SB_int:
+            if (decode_pcm_int_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
                 decode_pcm8_sb_int(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
                         vgmstream->channels,vgmstream->samples_into_block,
@@ -1141,6 +1791,9 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             }
             break;
         case coding_PCM8_U_int:
+            if (decode_pcm_int_bulk(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do))
+                break;
             for (chan=0;chan<vgmstream->channels;chan++) {
                 decode_pcm8_unsigned_int(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
                         vgmstream->channels,vgmstream->samples_into_block,
@@ -1197,6 +1850,14 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             }
             break;
         case coding_NGC_DTK:
+            /* both channels share each frame */
+            if (vgmstream->channels == 2 &&
+                    vgmstream->ch[0].streamfile == vgmstream->ch[1].streamfile &&
+                    vgmstream->ch[0].offset == vgmstream->ch[1].offset) {
+                decode_ngc_dtk_stereo(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do);
+                break;
+            }
             for (chan=0;chan<vgmstream->channels;chan++) {
                 decode_ngc_dtk(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
                         vgmstream->channels,vgmstream->samples_into_block,
@@ -1218,35 +1879,21 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             }
             break;
         case coding_PSX:
-            for (chan=0;chan<vgmstream->channels;chan++) {
-				if(vgmstream->skip_last_channel) 
-				{
-					if(chan!=vgmstream->channels-1) {
-						decode_psx(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-							vgmstream->channels,vgmstream->samples_into_block,
-							samples_to_do);
-					}
-
-				} else {
-					decode_psx(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
-                        samples_to_do);
-				}
-            }
-            break;
         case coding_PSX_badflags:
-            for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_psx_badflags(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
-                        samples_to_do);
-            }
-            break;
         case coding_invert_PSX:
-            for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_invert_psx(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
-                        samples_to_do);
-            }
+            /* all channels at once, skip_last_channel leaves the last one alone */
+            if (vgmstream->planar_buffers)
+                for (chan=0;chan<(vgmstream->skip_last_channel ? vgmstream->channels-1 : vgmstream->channels);chan++)
+                    decode_psx_channel(vgmstream,chan,CHANNEL_OUTBUF(chan),CHANNEL_SPACING,
+                            vgmstream->samples_into_block,samples_to_do);
+            else if (vgmstream->float_buffer)
+                decode_psx_channels_float(vgmstream,vgmstream->float_buffer+samples_written*vgmstream->channels,
+                        vgmstream->skip_last_channel ? vgmstream->channels-1 : vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do);
+            else
+                decode_psx_channels(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->skip_last_channel ? vgmstream->channels-1 : vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do);
             break;
         case coding_FFXI:
             for (chan=0;chan<vgmstream->channels;chan++) {
@@ -1263,11 +1910,9 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             }
             break;
         case coding_XA:
-            for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_xa(vgmstream,buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
-                        samples_to_do,chan);
-            }
+            /* whole sound group at once for all channels */
+            decode_xa(vgmstream,buffer+samples_written*vgmstream->channels,
+                    vgmstream->samples_into_block,samples_to_do);
             break;
         case coding_EAXA:
             for (chan=0;chan<vgmstream->channels;chan++) {
@@ -1292,9 +1937,14 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             break;
 #ifdef VGM_USE_VORBIS
         case coding_ogg_vorbis:
-            decode_ogg_vorbis(vgmstream->codec_data,
-                    buffer+samples_written*vgmstream->channels,samples_to_do,
-                    vgmstream->channels);
+            if (vgmstream->float_buffer)
+                decode_ogg_vorbis_float(vgmstream->codec_data,
+                        vgmstream->float_buffer+samples_written*vgmstream->channels,samples_to_do,
+                        vgmstream->channels);
+            else
+                decode_ogg_vorbis(vgmstream->codec_data,
+                        buffer+samples_written*vgmstream->channels,samples_to_do,
+                        vgmstream->channels);
             break;
 #endif
         case coding_SDX2:
@@ -1328,8 +1978,8 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
         case coding_DVI_IMA:
         case coding_INT_DVI_IMA:
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_dvi_ima(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_dvi_ima(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
             break;
@@ -1343,8 +1993,8 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
         case coding_IMA:
         case coding_INT_IMA:
             for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_ima(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
+                decode_ima(&vgmstream->ch[chan],CHANNEL_OUTBUF(chan),
+                        CHANNEL_SPACING,vgmstream->samples_into_block,
                         samples_to_do);
             }
             break;
@@ -1480,6 +2130,9 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
     }
 }
 
+#undef CHANNEL_OUTBUF
+#undef CHANNEL_SPACING
+
 int vgmstream_samples_to_do(int samples_this_block, int samples_per_frame, VGMSTREAM * vgmstream) {
     int samples_to_do;
     int samples_left_this_block;
@@ -1511,18 +2164,22 @@ int vgmstream_samples_to_do(int samples_this_block, int samples_per_frame, VGMST
 }
 
 /* return 1 if we just looped */
+int vgmstream_loop_keeps_history(VGMSTREAM * vgmstream) {
+    return vgmstream->meta_type == meta_DSP_STD ||
+        vgmstream->meta_type == meta_DSP_RS03 ||
+        vgmstream->meta_type == meta_DSP_CSTR ||
+        vgmstream->coding_type == coding_PSX ||
+        vgmstream->coding_type == coding_invert_PSX ||
+        vgmstream->coding_type == coding_PSX_badflags;
+}
+
 int vgmstream_do_loop(VGMSTREAM * vgmstream) {
 /*    if (vgmstream->loop_flag) {*/
         /* is this the loop end? */
         if (vgmstream->current_sample==vgmstream->loop_end_sample) {
             /* against everything I hold sacred, preserve adpcm
              * history through loop for certain types */
-            if (vgmstream->meta_type == meta_DSP_STD ||
-                    vgmstream->meta_type == meta_DSP_RS03 ||
-                    vgmstream->meta_type == meta_DSP_CSTR || 
-                    vgmstream->coding_type == coding_PSX ||
-                    vgmstream->coding_type == coding_invert_PSX ||
-                    vgmstream->coding_type == coding_PSX_badflags) {
+            if (vgmstream_loop_keeps_history(vgmstream)) {
                 int i;
                 for (i=0;i<vgmstream->channels;i++) {
                     vgmstream->loop_ch[i].adpcm_history1_16 = vgmstream->ch[i].adpcm_history1_16;
@@ -1587,6 +2244,8 @@ int vgmstream_do_loop(VGMSTREAM * vgmstream) {
             vgmstream->current_block_size=vgmstream->loop_block_size;
             vgmstream->current_block_offset=vgmstream->loop_block_offset;
             vgmstream->next_block_offset=vgmstream->loop_next_block_offset;
+            /* the group decoded is the one at the loop end */
+            vgmstream->xa_group_decoded=0;
 
             return 1;
         }
@@ -589,7 +589,7 @@ typedef struct {
 
     /* ADX encryption */
     int adx_channels;
-    uint16_t adx_xor;
+    uint16_t adx_xor;           /* key of the channel's first frame */
     uint16_t adx_mult;
     uint16_t adx_add;
 
@@ -601,7 +601,7 @@ typedef struct {
     uint16_t key_xor;
 } VGMSTREAMCHANNEL;
 
-typedef struct {
+typedef struct _VGMSTREAM {
     /* basics */
     int32_t num_samples;    /* the actual number of samples in this stream */
     int32_t sample_rate;    /* sample rate in Hz */
@@ -636,6 +636,10 @@ typedef struct {
 
     int hit_loop;                   /* have we seen the loop yet? */
 
+    /* layout operations, looked up from layout_type once at init */
+    void (*layout_render)(sample * buffer, int32_t sample_count, struct _VGMSTREAM * vgmstream);
+    void (*block_update)(off_t block_offset, struct _VGMSTREAM * vgmstream); /* NULL if not blocked */
+
     /* loop layout (saved values) */
     int32_t loop_sample;            /* saved from current_sample, should be loop_start_sample... */
     int32_t loop_samples_into_block;    /* saved from samples_into_block */
@@ -646,6 +650,10 @@ typedef struct {
     uint8_t xa_channel;				/* Selected XA Channel */
     int32_t xa_sector_length;		/* XA block */
 	uint8_t xa_headerless;			/* headerless XA block */
+    sample xa_group[28*8];          /* current XA sound group, decoded */
+    int xa_group_decoded;           /* xa_group is valid for this block */
+    int32_t xa_group_history[2][2]; /* adpcm history 1 and 2 of each channel
+                                       at the end of xa_group */
     int8_t get_high_nibble;
 
     uint8_t	ea_big_endian;			/* Big Endian ? */
@@ -661,6 +669,33 @@ typedef struct {
 	
 	int skip_last_channel;
 
+    /* decoded block for codecs that decode a whole block at a time,
+     * NULL if the coding doesn't use it (see decode_vgmstream) */
+    struct block_cache_data * block_cache;
+
+    /* output of codecs that can decode to float, only set while in
+     * render_vgmstream_float */
+    float * float_buffer;
+
+    /* per-channel output of codecs that can decode planar, only set while
+     * in render_vgmstream_planar */
+    sample ** planar_buffers;
+
+    /* buffers for decoding channels on different threads, NULL if the
+     * coding can't (see decode_vgmstream) */
+    struct parallel_decode_data * parallel_decode;
+
+    /* checkpoints for seek_vgmstream, NULL until the first seek */
+    struct seek_index_data * seek_index;
+
+    /* passes through the loop kept by vgmstream_set_loop_cache, NULL unless
+     * it was asked for */
+    struct loop_cache_data * loop_cache;
+
+    /* loops, fade and end of play for render_vgmstream_play, NULL until it
+     * is set or first played */
+    struct play_config_data * play_config;
+
 	/* Data the codec needs for the whole stream. This is for codecs too
      * different from vgmstream's structure to be reasonably shoehorned into
      * using the ch structures.
@@ -669,6 +704,35 @@ typedef struct {
     void * codec_data;
 } VGMSTREAM;
 
+/* One block of samples of every channel, interleaved. Blocks start with a
+ * header that resets the decoder, so a block can always be decoded from its
+ * start whatever the current channel state is. */
+typedef struct block_cache_data {
+    sample * buffer;                /* block_samples*channels */
+    int32_t block_samples;
+    int valid;
+    off_t offset;                   /* ch[0].offset the block was decoded at */
+    int32_t block_start;            /* samples_into_block of the block start */
+    VGMSTREAMCHANNEL * ch_saved;    /* channel state while decoding */
+    VGMSTREAMCHANNEL * ch_after;    /* channel state after the block */
+} block_cache_data;
+
+/* samples of each channel decoded at once by a thread, at most */
+#define PARALLEL_DECODE_SAMPLES 0x1000
+/* default for vgmstream_set_parallel_threshold */
+#define PARALLEL_DECODE_THRESHOLD 0x2000
+
+typedef struct parallel_decode_data {
+    int ready;                      /* 0 not set up yet, -1 couldn't be */
+    sample * buffer;                /* PARALLEL_DECODE_SAMPLES per channel */
+    sample ** channel_buffers;      /* where each channel decodes to */
+    STREAMFILE ** files;            /* per channel, for those sharing one */
+    int32_t first_sample;           /* the span being decoded */
+    int32_t samples_to_do;
+    int32_t samples_this_block;     /* interleave blocks the channels go */
+    off_t block_stride;             /* through, 0 stride for none */
+} parallel_decode_data;
+
 #ifdef VGM_USE_VORBIS
 typedef struct {
     STREAMFILE *streamfile;
@@ -693,12 +757,21 @@ typedef struct {
 #define AHX_EXPECTED_FRAME_SIZE 0x414
 /* MPEG_BUFFER_SIZE should be >= AHX_EXPECTED_FRAME_SIZE */
 #define MPEG_BUFFER_SIZE 0x1000
+/* frame sync search, bytes read at a time and how far to look */
+#define MPEG_SYNC_WINDOW_SIZE 0x1000
+#define MPEG_SYNC_SEARCH_SIZE 0x20000
 typedef struct {
     uint8_t buffer[MPEG_BUFFER_SIZE];
     int buffer_used;
     int buffer_full;
     size_t bytes_in_buffer;
     mpg123_handle *m;
+
+    /* offsets of the frames found so far (AHX), in file order */
+    off_t * frame_offsets;
+    int32_t frame_count;
+    int32_t frame_capacity;
+    int32_t frame_cursor;           /* likely index of the next frame */
 } mpeg_codec_data;
 #endif
 
@@ -728,7 +801,6 @@ typedef struct {
 #define AIX_BUFFER_SIZE 0x1000
 /* AIXery */
 typedef struct {
-    sample buffer[AIX_BUFFER_SIZE];
     int segment_count;
     int stream_count;
     int current_segment;
@@ -737,6 +809,11 @@ typedef struct {
     /* organized like:
      * segment1_stream1, segment1_stream2, segment2_stream1, segment2_stream2*/
     VGMSTREAM **adxs;
+    /* streams render each channel on its own, into buffer_samples long
+     * buffers (AIX_BUFFER_SIZE to start, grown for longer renders) */
+    sample **channel_buffers;
+    int32_t buffer_samples;
+    int32_t samples_to_do;
 } aix_codec_data;
 
 typedef struct {
@@ -753,10 +830,16 @@ typedef struct {
     NWAData *nwa;
 } nwa_codec_data;
 
+#define SCD_INT_BUFFER_SIZE 0x1000
 typedef struct {
     int substream_count;
     VGMSTREAM **substreams;
     STREAMFILE **intfiles;
+    /* each substream renders to its own buffer, buffer_samples long
+     * (SCD_INT_BUFFER_SIZE to start, grown for longer renders) */
+    sample **buffers;
+    int32_t buffer_samples;
+    int32_t samples_to_do;
 } scd_int_codec_data;
 
 /* do format detection, return pointer to a usable VGMSTREAM, or NULL on failure */
@@ -770,15 +853,124 @@ void reset_vgmstream(VGMSTREAM * vgmstream);
 /* allocate a VGMSTREAM and channel stuff */
 VGMSTREAM * allocate_vgmstream(int channel_count, int looped);
 
+/* set the layout render and block update operations from layout_type,
+ * must be called after the layout_type is final */
+void setup_vgmstream_layout(VGMSTREAM * vgmstream);
+
 /* deallocate, close, etc. */
 void close_vgmstream(VGMSTREAM * vgmstream);
 
 /* calculate the number of samples to be played based on looping parameters */
 int32_t get_vgmstream_play_samples(double looptimes, double fadeseconds, double fadedelayseconds, VGMSTREAM * vgmstream);
 
+/* shape of the fade out */
+typedef enum {
+    fade_curve_linear,      /* volume down by the same amount each sample */
+    fade_curve_log          /* down by the same dB each sample, -60 dB
+                               over the fade (shifted to end in silence) */
+} fade_curve_t;
+
+/* How a stream is played by render_vgmstream_play. */
+typedef struct {
+    double loop_count;          /* times through the loop, may be fractional */
+    double fade_seconds;        /* fade out at the end of looping streams */
+    double fade_delay_seconds;  /* played after the loops, before the fade */
+    fade_curve_t fade_curve;
+    int ignore_loop;            /* play to the end once */
+    int force_loop;             /* loop the whole stream: 1 if it has no
+                                   loop, 2 even if it has one (not AIX or
+                                   AAX, they keep their own loop) */
+    int play_forever;           /* looping streams don't end nor fade */
+} vgmstream_play_config;
+
+/* Set how the stream is played, before rendering with render_vgmstream_play.
+ * The loop settings are changed as the config says (and kept on reset and
+ * seek), setting it again starts over from the stream's own loop. NULL
+ * takes the defaults: 2 loops, a 10 second fade and no delay. Returns 0 on
+ * failure. */
+int vgmstream_set_play_config(VGMSTREAM * vgmstream, const vgmstream_play_config * config);
+
+/* samples render_vgmstream_play renders in all, -1 if it doesn't stop */
+int32_t get_vgmstream_play_length(VGMSTREAM * vgmstream);
+
 /* render! */
 void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 
+/* render as the play config says (defaults if none was set): up to the end
+ * of play, with the fade applied. Returns the samples rendered, fewer than
+ * sample_count at the end and 0 after it. */
+int32_t render_vgmstream_play(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
+/* render as float, with 1.0 as full scale. Codecs that can decode to float
+ * do so directly and may go past full scale, others are converted from
+ * 16-bit samples. */
+void render_vgmstream_float(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
+/* render each channel to its own buffer, channels[n] gets sample_count
+ * samples of channel n. Use kernels->interleave to join them again. */
+void render_vgmstream_planar(sample ** channels, int32_t sample_count, VGMSTREAM * vgmstream);
+
+/* Seek to sample_position, counted as render_vgmstream samples from the
+ * start (loops included). PCM and block codecs go straight there without
+ * decoding, Ogg Vorbis and MPEG use the codec's own seeking. Other streams
+ * with all their state in the VGMSTREAM keep checkpoints as they are passed,
+ * so a seek restores the closest one and decodes less than
+ * SEEK_CHECKPOINT_SAMPLES. Passes through the loop that
+ * decode the same as an earlier one aren't decoded again, so a seek costs
+ * the same however many loops come before. Others are reset and decoded
+ * up to it. Loop settings changed after init are kept. */
+void seek_vgmstream(VGMSTREAM * vgmstream, int32_t sample_position);
+
+/* Write the checkpoints seek_vgmstream has taken so far to a file, or read
+ * them back for the same stream with the same loop settings. Return 0 on
+ * failure or for streams without checkpoints. */
+int save_vgmstream_seek_index(VGMSTREAM * vgmstream, const char * filename);
+int load_vgmstream_seek_index(VGMSTREAM * vgmstream, const char * filename);
+
+/* Keep checkpoints in files in this directory, named after a hash of the
+ * stream, so a later open of the same file seeks fast from the start.
+ * NULL (the default) stops it. */
+void vgmstream_set_seek_cache_dir(const char * path);
+
+/* Write the decoding state of the stream (position, channels, loop, play
+ * config and the codec's state) to buf, to load into another open of the
+ * same file and go on from there. A NULL buf only counts the size. Returns
+ * the bytes written, or 0 if they don't fit or the codec's state can't be
+ * written (seek_vgmstream gets there too, slower). */
+size_t save_vgmstream_state(VGMSTREAM * vgmstream, uint8_t * buf, size_t size);
+
+/* Returns 0 if the state isn't for this stream or is broken, the stream is
+ * reset then. */
+int load_vgmstream_state(VGMSTREAM * vgmstream, const uint8_t * buf, size_t size);
+
+/* Keep a pass through the loop in memory once it is decoded, and play the
+ * later passes from there instead of decoding them again. Only for loops
+ * of at most max_bytes of samples (all channels), 0 turns it off. Returns
+ * 1 if it's on. Output is the same as without it. */
+int vgmstream_set_loop_cache(VGMSTREAM * vgmstream, size_t max_bytes);
+
+/* Decode calls covering at least channel_samples (samples times channels)
+ * split the channels between worker threads, for codecs where channels are
+ * independent. 0 keeps all decoding on the calling thread. Channels that
+ * share a file get one of their own the first time a call is split. The
+ * number of threads can be set with the VGMSTREAM_THREADS environment
+ * variable. */
+void vgmstream_set_parallel_threshold(int32_t channel_samples);
+
+/* if work on channel_samples (samples times channels) is worth splitting
+ * between threads, for layouts that render sub-streams apart */
+int vgmstream_parallel_wanted(int32_t channel_samples);
+
+/* For layouts that decode a frame at a time: decode up to sample_count
+ * samples from the current position (stopping at loop points) with a
+ * thread for each channel. Each channel moves on by block_stride at the
+ * end of each interleave block of samples_this_block, a 0 block_stride
+ * for a stream that is one block. Returns the samples decoded, with the
+ * position moved past them, or 0 if it's not worth it (or can't be done)
+ * and the layout should decode them itself. */
+int32_t decode_vgmstream_span(VGMSTREAM * vgmstream, int samples_written, int32_t sample_count, sample * buffer,
+        int32_t samples_this_block, off_t block_stride);
+
 /* smallest self-contained group of samples is a frame */
 int get_vgmstream_samples_per_frame(VGMSTREAM * vgmstream);
 /* number of bytes per frame */
@@ -802,6 +994,10 @@ int vgmstream_samples_to_do(int samples_this_block, int samples_per_frame, VGMST
  * Returns 1 if loop was done. */
 int vgmstream_do_loop(VGMSTREAM * vgmstream);
 
+/* If the adpcm history at the loop end is carried into the loop start, so
+ * the first passes through the loop may not decode the same. */
+int vgmstream_loop_keeps_history(VGMSTREAM * vgmstream);
+
 /* Write a description of the stream into array pointed by desc,
  * which must be length bytes long. Will always be null-terminated if length > 0
  */
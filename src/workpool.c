@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include "workpool.h"
+
+#ifdef WIN32
+#include <windows.h>
+
+typedef CRITICAL_SECTION wp_mutex;
+typedef HANDLE wp_sem;
+
+static int wp_mutex_init(wp_mutex * m) { InitializeCriticalSection(m); return 1; }
+static void wp_mutex_lock(wp_mutex * m) { EnterCriticalSection(m); }
+static void wp_mutex_unlock(wp_mutex * m) { LeaveCriticalSection(m); }
+
+static int wp_sem_init(wp_sem * s) {
+    *s = CreateSemaphore(NULL,0,WORKPOOL_MAX_THREADS,NULL);
+    return *s != NULL;
+}
+static void wp_sem_post(wp_sem * s) { ReleaseSemaphore(*s,1,NULL); }
+static void wp_sem_wait(wp_sem * s) { WaitForSingleObject(*s,INFINITE); }
+
+static int cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+}
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t wp_mutex;
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+} wp_sem;
+
+static int wp_mutex_init(wp_mutex * m) { return pthread_mutex_init(m,NULL) == 0; }
+static void wp_mutex_lock(wp_mutex * m) { pthread_mutex_lock(m); }
+static void wp_mutex_unlock(wp_mutex * m) { pthread_mutex_unlock(m); }
+
+static int wp_sem_init(wp_sem * s) {
+    s->count = 0;
+    if (pthread_mutex_init(&s->lock,NULL)) return 0;
+    if (pthread_cond_init(&s->cond,NULL)) return 0;
+    return 1;
+}
+static void wp_sem_post(wp_sem * s) {
+    pthread_mutex_lock(&s->lock);
+    s->count++;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+}
+static void wp_sem_wait(wp_sem * s) {
+    pthread_mutex_lock(&s->lock);
+    while (s->count == 0)
+        pthread_cond_wait(&s->cond,&s->lock);
+    s->count--;
+    pthread_mutex_unlock(&s->lock);
+}
+
+static int cpu_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    return 1;
+#endif
+}
+#endif
+
+/* indexes from next to end-1 are left for one thread */
+typedef struct {
+    int next;
+    int end;
+} workpool_slot;
+
+struct workpool {
+    int threads;
+    int busy;
+
+    /* the current job, the slots are only touched with lock held */
+    wp_mutex lock;
+    workpool_task task;
+    void * arg;
+    workpool_slot slots[WORKPOOL_MAX_THREADS];
+
+    wp_sem wake;    /* posted for each worker when a job starts */
+    wp_sem done;    /* posted by a worker when it finds no more work */
+};
+
+static workpool the_pool;
+static workpool * pool_ready = NULL;
+
+/* Next index for the thread of this slot, -1 once everything is taken.
+ * A thread that runs out takes the back half of the fullest slot. */
+static int take_index(workpool * pool, workpool_slot * own) {
+    int index = -1;
+
+    wp_mutex_lock(&pool->lock);
+    if (own->next == own->end) {
+        workpool_slot * victim = NULL;
+        int i, most = 0;
+
+        for (i=0;i<pool->threads;i++) {
+            int left = pool->slots[i].end - pool->slots[i].next;
+            if (left > most) {
+                most = left;
+                victim = &pool->slots[i];
+            }
+        }
+        if (victim) {
+            own->end = victim->end;
+            own->next = victim->end - (most+1)/2;
+            victim->end = own->next;
+        }
+    }
+    if (own->next < own->end)
+        index = own->next++;
+    wp_mutex_unlock(&pool->lock);
+
+    return index;
+}
+
+static void work(workpool * pool, workpool_slot * own) {
+    int index;
+
+    while ((index = take_index(pool,own)) >= 0)
+        pool->task(pool->arg,index);
+}
+
+/* A worker can take the wake meant for another one if it is quick
+ * enough, that's fine as each wake taken still posts one done. */
+static void worker_loop(workpool_slot * own) {
+    workpool * pool = &the_pool;
+
+    for (;;) {
+        wp_sem_wait(&pool->wake);
+        work(pool,own);
+        wp_sem_post(&pool->done);
+    }
+}
+
+#ifdef WIN32
+static DWORD WINAPI worker_thread(LPVOID arg) {
+    worker_loop(arg);
+    return 0;
+}
+
+static int start_thread(workpool_slot * own) {
+    HANDLE thread = CreateThread(NULL,0,worker_thread,own,0,NULL);
+    if (!thread) return 0;
+    CloseHandle(thread);
+    return 1;
+}
+#else
+static void * worker_thread(void * arg) {
+    worker_loop(arg);
+    return NULL;
+}
+
+static int start_thread(workpool_slot * own) {
+    pthread_t thread;
+    if (pthread_create(&thread,NULL,worker_thread,own)) return 0;
+    pthread_detach(thread);
+    return 1;
+}
+#endif
+
+static void init_workpool(void) {
+    workpool * pool = &the_pool;
+    const char * forced;
+    int threads, i;
+
+    threads = cpu_count();
+    forced = getenv("VGMSTREAM_THREADS");
+    if (forced)
+        threads = atoi(forced);
+    if (threads > WORKPOOL_MAX_THREADS)
+        threads = WORKPOOL_MAX_THREADS;
+    if (threads < 2)
+        return;
+
+    if (!wp_mutex_init(&pool->lock)) return;
+    if (!wp_sem_init(&pool->wake)) return;
+    if (!wp_sem_init(&pool->done)) return;
+
+    /* slot 0 is the calling thread's */
+    pool->threads = 1;
+    pool->busy = 0;
+    for (i=1;i<threads;i++) {
+        if (!start_thread(&pool->slots[i])) break;
+        pool->threads++;
+    }
+
+    if (pool->threads > 1)
+        pool_ready = pool;
+}
+
+#ifdef WIN32
+static volatile LONG init_state = 0;
+
+workpool * get_workpool(void) {
+    /* 0: not started, 1: starting, 2: done */
+    if (InterlockedCompareExchange(&init_state,1,0) == 0) {
+        init_workpool();
+        InterlockedExchange(&init_state,2);
+    }
+    while (init_state != 2)
+        Sleep(0);
+    return pool_ready;
+}
+#else
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+workpool * get_workpool(void) {
+    pthread_once(&init_once,init_workpool);
+    return pool_ready;
+}
+#endif
+
+int workpool_threads(workpool * pool) {
+    return pool ? pool->threads : 1;
+}
+
+void workpool_run(workpool * pool, workpool_task task, void * arg, int count) {
+    int i, busy = 1;
+
+    if (pool && count > 1) {
+        wp_mutex_lock(&pool->lock);
+        busy = pool->busy;
+        pool->busy = 1;
+        wp_mutex_unlock(&pool->lock);
+    }
+
+    if (busy) {
+        for (i=0;i<count;i++)
+            task(arg,i);
+        return;
+    }
+
+    /* nobody else looks at the slots until the workers are woken */
+    pool->task = task;
+    pool->arg = arg;
+    for (i=0;i<pool->threads;i++) {
+        pool->slots[i].next = count*i/pool->threads;
+        pool->slots[i].end = count*(i+1)/pool->threads;
+    }
+
+    for (i=1;i<pool->threads;i++)
+        wp_sem_post(&pool->wake);
+    work(pool,&pool->slots[0]);
+    for (i=1;i<pool->threads;i++)
+        wp_sem_wait(&pool->done);
+
+    wp_mutex_lock(&pool->lock);
+    pool->busy = 0;
+    wp_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,31 @@
+/*
+ * workpool.h - persistent worker threads for splitting decoding work
+ */
+
+#ifndef _WORKPOOL_H
+#define _WORKPOOL_H
+
+/* most threads a pool uses, the calling thread included */
+#define WORKPOOL_MAX_THREADS 16
+
+/* called once for each index from 0 to count-1, in any order and from any
+ * thread of the pool */
+typedef void (*workpool_task)(void * arg, int index);
+
+typedef struct workpool workpool;
+
+/* The shared pool, started on first use with one thread per CPU, or as many
+ * as the VGMSTREAM_THREADS environment variable says. NULL if there is only
+ * one thread to work with or the threads can't be started. */
+workpool * get_workpool(void);
+
+/* threads that work on a workpool_run, the calling thread included */
+int workpool_threads(workpool * pool);
+
+/* Run task for every index and return when all are done. Indexes are split
+ * between the threads up front, threads that run out steal from the others.
+ * If the pool is busy (another workpool_run, or one of its own tasks) the
+ * calling thread does all the work itself. */
+void workpool_run(workpool * pool, workpool_task task, void * arg, int count);
+
+#endif
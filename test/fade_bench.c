@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../src/vgmstream.h"
+#include "../src/kernels.h"
+
+/* Times the fade render_vgmstream_play does against the one test.c used to
+ * do itself, a double multiply per sample. 8 channels at 48 kHz by default,
+ * a 10 second fade rendered BUFSIZE frames at a time, like test.c. The
+ * kernels are the ones for this CPU, VGMSTREAM_CPU=scalar times the plain C
+ * ones. */
+
+#define BUFSIZE 4000
+#define FADE_SECONDS 10
+#define REPEATS 20
+
+/* the old fade, from test.c */
+static void fade_double(sample * buf, int channels, int count,
+        int32_t fade_samples, int32_t samples_into_fade) {
+    int j,k;
+
+    for (j=0;j<count;j++,samples_into_fade++) {
+        if (samples_into_fade > 0) {
+            double fadedness = (double)(fade_samples-samples_into_fade)/fade_samples;
+            for (k=0;k<channels;k++) {
+                buf[j*channels+k] = buf[j*channels+k]*fadedness;
+            }
+        }
+    }
+}
+
+/* the new one, the volume stepped by the kernel */
+static void fade_kernel(sample * buf, int channels, int count,
+        int32_t fade_samples, int32_t samples_into_fade) {
+    const vgmstream_kernels * kernels = get_kernels();
+    int32_t volume = (int32_t)(((int64_t)(fade_samples - samples_into_fade) << 30) / fade_samples);
+    int32_t volume_step = -(int32_t)(((int64_t)1 << 30) / fade_samples);
+
+    kernels->fade_linear(buf,channels,count,volume,volume_step);
+}
+
+/* seconds per REPEATS fades over a copy of src */
+static double time_fade(void (*fade)(sample *, int, int, int32_t, int32_t),
+        const sample * src, sample * buf, int channels, int32_t fade_samples) {
+    clock_t start;
+    int32_t i;
+    int rep;
+
+    start = clock();
+    for (rep=0;rep<REPEATS;rep++) {
+        memcpy(buf,src,fade_samples*channels*sizeof(sample));
+        for (i=0;i<fade_samples;i+=BUFSIZE) {
+            int count = fade_samples-i < BUFSIZE ? fade_samples-i : BUFSIZE;
+            fade(buf+i*channels,channels,count,fade_samples,i);
+        }
+    }
+    return (double)(clock()-start)/CLOCKS_PER_SEC;
+}
+
+int main(int argc, char ** argv) {
+    int channels = argc > 1 ? atoi(argv[1]) : 8;
+    int sample_rate = argc > 2 ? atoi(argv[2]) : 48000;
+    int32_t fade_samples, i;
+    sample * src, * buf, * old_buf;
+    double copy_time, old_time, new_time;
+    int max_diff = 0;
+
+    if (channels < 1 || sample_rate < 1) {
+        fprintf(stderr,"Usage: %s [channels] [sample rate]\n",argv[0]);
+        return 1;
+    }
+
+    fade_samples = FADE_SECONDS * sample_rate;
+    src = malloc(fade_samples*channels*sizeof(sample));
+    buf = malloc(fade_samples*channels*sizeof(sample));
+    old_buf = malloc(fade_samples*channels*sizeof(sample));
+    if (!src || !buf || !old_buf) {
+        fprintf(stderr,"out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    for (i=0;i<fade_samples*channels;i++)
+        src[i] = (rand() & 0xffff) - 0x8000;
+
+    init_kernels();
+
+    /* the copy each repeat starts with isn't counted */
+    {
+        clock_t start = clock();
+        for (i=0;i<REPEATS;i++)
+            memcpy(buf,src,fade_samples*channels*sizeof(sample));
+        copy_time = (double)(clock()-start)/CLOCKS_PER_SEC;
+    }
+
+    old_time = time_fade(fade_double,src,old_buf,channels,fade_samples);
+    new_time = time_fade(fade_kernel,src,buf,channels,fade_samples);
+
+    for (i=0;i<fade_samples*channels;i++) {
+        int diff = abs(buf[i] - old_buf[i]);
+        if (diff > max_diff) max_diff = diff;
+    }
+
+    printf("%d channels, %d Hz, %s kernels\n",channels,sample_rate,
+            get_cpu_level_name(get_cpu_level()));
+    printf("old fade: %.2f ns/frame\n",(old_time-copy_time)/REPEATS/fade_samples*1e9);
+    printf("new fade: %.2f ns/frame\n",(new_time-copy_time)/REPEATS/fade_samples*1e9);
+    printf("largest difference: %d\n",max_diff);
+
+    free(src);
+    free(buf);
+    free(old_buf);
+    return 0;
+}
@@ -15,12 +15,13 @@ extern int optind, opterr, optopt;
 void usage(const char * name) {
     fprintf(stderr,"vgmstream test decoder " VERSION " " __DATE__ "\n"
           "Usage: %s [-o outfile.wav] [-l loop count]\n"
-          "    [-f fade time] [-d fade delay] [-ipcmxeE] infile\n"
+          "    [-f fade time] [-d fade delay] [-ipcmxeEF] infile\n"
           "Options:\n"
           "    -o outfile.wav: name of output .wav file, default is dump.wav\n"
           "    -l loop count: loop count, default 2.0\n"
           "    -f fade time: fade time (seconds), default 10.0\n"
           "    -d fade delay: fade delay (seconds, default 0.0\n"
+          "    -F: logarithmic fade instead of linear\n"
           "    -i: ignore looping information and play the whole stream once\n"
           "    -p: output to stdout (for piping into another program)\n"
           "    -P: output to stdout even if stdout is a terminal\n"
@@ -41,8 +42,8 @@ int main(int argc, char ** argv) {
     VGMSTREAM * s;
     sample * buf = NULL;
     int32_t len;
-    int32_t fade_samples;
-    int i;
+    int32_t toget;
+    vgmstream_play_config config = {0};
     FILE * outfile = NULL;
     char * outfilename = NULL;
     char * reset_outfilename = NULL;
@@ -50,6 +51,7 @@ int main(int argc, char ** argv) {
     int ignore_loop = 0;
     int force_loop = 0;
     int really_force_loop = 0;
+    int log_fade = 0;
     int play = 0;
     int play_wreckless = 0;
     int forever = 0;
@@ -62,7 +64,7 @@ int main(int argc, char ** argv) {
     double fade_seconds = 10.0;
     double fade_delay_seconds = 0.0;
 
-    while ((opt = getopt(argc, argv, "o:l:f:d:ipPcmxeEr:gb2:")) != -1) {
+    while ((opt = getopt(argc, argv, "o:l:f:d:FipPcmxeEr:gb2:")) != -1) {
         switch (opt) {
             case 'o':
                 outfilename = optarg;
@@ -76,6 +78,9 @@ int main(int argc, char ** argv) {
             case 'd':
                 fade_delay_seconds = atof(optarg);
                 break;
+            case 'F':
+                log_fade = 1;
+                break;
             case 'i':
                 ignore_loop = 1;
                 break;
@@ -162,26 +167,20 @@ int main(int argc, char ** argv) {
         return 1;
     }
 
-    /* force only if there aren't already loop points */
-    if (force_loop && !s->loop_flag) {
-        /* this requires a bit more messing with the VGMSTREAM than I'm
-         * comfortable with... */
-        s->loop_flag=1;
-        s->loop_start_sample=0;
-        s->loop_end_sample=s->num_samples;
-        s->loop_ch=calloc(s->channels,sizeof(VGMSTREAMCHANNEL));
-    }
-
-    /* force even if there are loop points */
-    if (really_force_loop) {
-        if (!s->loop_flag) s->loop_ch=calloc(s->channels,sizeof(VGMSTREAMCHANNEL));
-        s->loop_flag=1;
-        s->loop_start_sample=0;
-        s->loop_end_sample=s->num_samples;
+    config.loop_count = loop_count;
+    config.fade_seconds = fade_seconds;
+    config.fade_delay_seconds = fade_delay_seconds;
+    config.fade_curve = log_fade ? fade_curve_log : fade_curve_linear;
+    config.ignore_loop = ignore_loop;
+    /* -e only if there aren't already loop points, -E even if there are */
+    if (force_loop) config.force_loop = 1;
+    if (really_force_loop) config.force_loop = 2;
+
+    if (!vgmstream_set_play_config(s,&config)) {
+        fprintf(stderr,"failed setting up play of %s\n",argv[optind]);
+        return 1;
     }
 
-    if (ignore_loop) s->loop_flag=0;
-
     if (play) {
         if (outfilename) {
             fprintf(stderr,"either -p or -o, make up your mind\n");
@@ -236,9 +235,8 @@ int main(int argc, char ** argv) {
 
     buf = malloc(BUFSIZE*sizeof(sample)*s->channels);
 
-    len = get_vgmstream_play_samples(loop_count,fade_seconds,fade_delay_seconds,s);
+    len = get_vgmstream_play_length(s);
     if (!play && !adxencd && !oggenc && !batchvar) printf("samples to play: %d (%.4lf seconds)\n",len,(double)len/s->sample_rate);
-    fade_samples = fade_seconds * s->sample_rate;
 
     /* slap on a .wav header */
     if (only_stereo != -1) {
@@ -262,26 +260,8 @@ int main(int argc, char ** argv) {
         }
     }
 
-    /* decode */
-    for (i=0;i<len;i+=BUFSIZE) {
-        int toget=BUFSIZE;
-        if (i+BUFSIZE>len) toget=len-i;
-        render_vgmstream(buf,toget,s);
-
-        if (s->loop_flag && fade_samples > 0) {
-            int samples_into_fade = i - (len - fade_samples);
-            if (samples_into_fade + toget > 0) {
-                int j,k;
-                for (j=0;j<toget;j++,samples_into_fade++) {
-                    if (samples_into_fade > 0) {
-                        double fadedness = (double)(fade_samples-samples_into_fade)/fade_samples;
-                        for (k=0;k<s->channels;k++) {
-                            buf[j*s->channels+k] = buf[j*s->channels+k]*fadedness;
-                        }
-                    }
-                }
-            }
-        }
+    /* decode, the library ends and fades it */
+    while ((toget = render_vgmstream_play(buf,BUFSIZE,s)) > 0) {
         swap_samples_le(buf,s->channels*toget);
 
         if (only_stereo != -1) {
@@ -333,51 +313,11 @@ int main(int argc, char ** argv) {
         make_wav_header((uint8_t*)buf, len, s->sample_rate, s->channels);
         fwrite(buf,1,0x2c,outfile);
 
+        /* the play config is kept, play starts over */
         reset_vgmstream(s);
 
-        /* these manipulations are undone by reset */
-
-        /* force only if there aren't already loop points */
-        if (force_loop && !s->loop_flag) {
-            /* this requires a bit more messing with the VGMSTREAM than I'm
-             * comfortable with... */
-            s->loop_flag=1;
-            s->loop_start_sample=0;
-            s->loop_end_sample=s->num_samples;
-            s->loop_ch=calloc(s->channels,sizeof(VGMSTREAMCHANNEL));
-        }
-
-        /* force even if there are loop points */
-        if (really_force_loop) {
-            if (!s->loop_flag) s->loop_ch=calloc(s->channels,sizeof(VGMSTREAMCHANNEL));
-            s->loop_flag=1;
-            s->loop_start_sample=0;
-            s->loop_end_sample=s->num_samples;
-        }
-
-        if (ignore_loop) s->loop_flag=0;
-
         /* decode */
-        for (i=0;i<len;i+=BUFSIZE) {
-            int toget=BUFSIZE;
-            if (i+BUFSIZE>len) toget=len-i;
-            render_vgmstream(buf,toget,s);
-
-            if (s->loop_flag && fade_samples > 0) {
-                int samples_into_fade = i - (len - fade_samples);
-                if (samples_into_fade + toget > 0) {
-                    int j,k;
-                    for (j=0;j<toget;j++,samples_into_fade++) {
-                        if (samples_into_fade > 0) {
-                            double fadedness = (double)(fade_samples-samples_into_fade)/fade_samples;
-                            for (k=0;k<s->channels;k++) {
-                                buf[j*s->channels+k] = buf[j*s->channels+k]*fadedness;
-                            }
-                        }
-                    }
-                }
-            }
-
+        while ((toget = render_vgmstream_play(buf,BUFSIZE,s)) > 0) {
             /* do proper little endian samples */
             swap_samples_le(buf,s->channels*toget);
             if (only_stereo != -1) {
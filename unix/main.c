@@ -28,7 +28,6 @@ static GThread *decode_thread;
 static GCond *ctrl_cond = NULL;
 static GMutex *ctrl_mutex = NULL;
 static gint stream_length_samples;
-static gint fade_length_samples;
 SETTINGS settings;
 static gint decode_pos_samples = 0;
 static VGMSTREAM *vgmstream = NULL;
@@ -72,33 +71,12 @@ void* vgmstream_play_loop(InputPlayback *playback)
     {
       /* compute from ms to samples */
       seek_needed_samples = (long long)decode_seek * vgmstream->sample_rate / 1000L;
-      if (seek_needed_samples < decode_pos_samples)
+      /* nothing to do if we are already there */
+      if (seek_needed_samples != decode_pos_samples)
       {
-	/* go back in time, reopen file */
-	reset_vgmstream(vgmstream);
-	decode_pos_samples = 0;
-	samples_to_do = seek_needed_samples;
-      }
-      else if (decode_pos_samples < seek_needed_samples)
-      {
-	/* go forward in time */
-	samples_to_do = seek_needed_samples - decode_pos_samples;
-      }
-      else
-      {
-	/* seek to where we are, how convenient */
-	samples_to_do = -1;
-      }
-      /* do the actual seeking */
-      if (samples_to_do >= 0)
-      {
-	while (samples_to_do > 0)
-	{
-	  l = min(576,samples_to_do);
-	  render_vgmstream(buffer,l,vgmstream);
-	  samples_to_do -= l;
-	  decode_pos_samples += l;
-	}
+	/* do the actual seeking */
+	seek_vgmstream(vgmstream,seek_needed_samples);
+	decode_pos_samples = seek_needed_samples;
 	playback->output->flush(decode_seek);
 	// reset eof flag
 	playback->eof = 0;
@@ -112,8 +90,8 @@ void* vgmstream_play_loop(InputPlayback *playback)
     // ******************************************
     if (!playback->eof)
     {
-      // read data and pass onward
-      samples_to_do = min(576,stream_length_samples - (decode_pos_samples + 576));
+      // read data and pass onward, vgmstream knows where it ends
+      samples_to_do = render_vgmstream_play(buffer,576,vgmstream);
       l = (samples_to_do * vgmstream->channels*2);
       if (!l)
       {
@@ -122,25 +100,7 @@ void* vgmstream_play_loop(InputPlayback *playback)
       }
       else
       {
-	// ok we read stuff
-	render_vgmstream(buffer,samples_to_do,vgmstream);
-
-    // fade!
-    if (vgmstream->loop_flag && fade_length_samples > 0 && !loop_forever) {
-        int samples_into_fade = decode_pos_samples - (stream_length_samples - fade_length_samples);
-        if (samples_into_fade + samples_to_do > 0) {
-            int j,k;
-            for (j=0;j<samples_to_do;j++,samples_into_fade++) {
-                if (samples_into_fade > 0) {
-                    double fadedness = (double)(fade_length_samples-samples_into_fade)/fade_length_samples;
-                    for (k=0;k<vgmstream->channels;k++) {
-                        buffer[j*vgmstream->channels+k] =
-                            (short)(buffer[j*vgmstream->channels+k]*fadedness);
-                    }
-                }
-            }
-        }
-    }
+	// ok we read stuff, faded by vgmstream
 
     // pass it on
 	playback->pass_audio(playback,FMT_S16_LE,vgmstream->channels , l , buffer , &playback->playing );
@@ -221,15 +181,23 @@ void vgmstream_play(InputPlayback *context)
 
   /* copy file name */
   strcpy(strPlaying,context->filename);
-  // set the info
-  stream_length_samples = get_vgmstream_play_samples(settings.loopcount,settings.fadeseconds,settings.fadedelayseconds,vgmstream);
-  if (vgmstream->loop_flag)
+  // loops and fade are done by vgmstream
   {
-      fade_length_samples = settings.fadeseconds * vgmstream->sample_rate;
-  } else {
-      fade_length_samples = -1;
+    vgmstream_play_config config = {0};
+    config.loop_count = settings.loopcount;
+    config.fade_seconds = settings.fadeseconds;
+    config.fade_delay_seconds = settings.fadedelayseconds;
+    config.play_forever = loop_forever;
+    if (!vgmstream_set_play_config(vgmstream,&config))
+    {
+      CLOSE_STREAM();
+      goto end_thread;
+    }
   }
-  gint ms = (stream_length_samples * 1000LL) / vgmstream->sample_rate;
+  // set the info
+  stream_length_samples = get_vgmstream_play_length(vgmstream);
+  // -1 when it plays forever
+  gint ms = stream_length_samples < 0 ? -1 : (stream_length_samples * 1000LL) / vgmstream->sample_rate;
   gint rate   = vgmstream->sample_rate * 2 * vgmstream->channels;
 
   Tuple * tuple = tuple_new_from_filename(context->filename);
@@ -69,7 +69,6 @@ int seek_needed_samples = -1;
 int decode_pos_ms = 0;
 int decode_pos_samples = 0;
 int stream_length_samples = 0;
-int fade_samples = 0;
 
 #define EXTENSION_LIST_SIZE 10240
 char working_extension_list[EXTENSION_LIST_SIZE] = {0};
@@ -473,7 +472,6 @@ int play(char *fn)
     if (!vgmstream) {
         return 1;
     }
-    if (ignore_loop) vgmstream->loop_flag = 0;
     /* will we be able to play it? */
     if (vgmstream->channels <= 0) {
         close_vgmstream(vgmstream);
@@ -494,6 +492,22 @@ int play(char *fn)
         return 1;
     }
 
+    /* loops and fade are done by vgmstream */
+    {
+        vgmstream_play_config config = {0};
+
+        config.loop_count = loop_count;
+        config.fade_seconds = fade_seconds;
+        config.fade_delay_seconds = fade_delay_seconds;
+        config.ignore_loop = ignore_loop;
+        config.play_forever = loop_forever;
+        if (!vgmstream_set_play_config(vgmstream,&config)) {
+            close_vgmstream(vgmstream);
+            vgmstream=NULL;
+            return 1;
+        }
+    }
+
     /* Set info display */
     /* TODO: actual bitrate */
     input_module.SetInfo(100,vgmstream->sample_rate/1000,vgmstream->channels,1);
@@ -507,9 +521,7 @@ int play(char *fn)
     decode_pos_ms = 0;
     decode_pos_samples = 0;
     paused = 0;
-    stream_length_samples = get_vgmstream_play_samples(loop_count,fade_seconds,fade_delay_seconds,vgmstream);
-
-    fade_samples = (int)(fade_seconds * vgmstream->sample_rate);
+    stream_length_samples = get_vgmstream_play_length(vgmstream);
 
     decode_thread_handle = CreateThread(
             NULL,   /* handle cannot be inherited */
@@ -554,6 +566,9 @@ void stop() {
 
 /* get current stream length */
 int getlength() {
+    /* looping forever, Winamp's unknown length */
+    if (stream_length_samples < 0)
+        return -1000;
     return stream_length_samples*1000LL/vgmstream->sample_rate;
 }
 
@@ -644,75 +659,43 @@ DWORD WINAPI __stdcall decode(void *arg) {
         int samples_to_do;
         int l;
 
-        if (decode_pos_samples+max_buffer_samples>stream_length_samples && (!loop_forever || !vgmstream->loop_flag))
-            samples_to_do=stream_length_samples-decode_pos_samples;
-        else
-            samples_to_do=max_buffer_samples;
-
-        /* play 'till the end of this seek, or note if we're done seeking */
+        /* seek, the loop settings (ignore_loop) are kept */
         if (seek_needed_samples != -1) {
-            /* reset if we need to seek backwards */
-            if (seek_needed_samples < decode_pos_samples) {
-                reset_vgmstream(vgmstream);
+            if (stream_length_samples >= 0 && seek_needed_samples > stream_length_samples)
+                seek_needed_samples = stream_length_samples;
 
-                if (ignore_loop) vgmstream->loop_flag = 0;
-
-                decode_pos_samples = 0;
-                decode_pos_ms = 0;
-            }
+            seek_vgmstream(vgmstream,seek_needed_samples);
 
-            if (decode_pos_samples < seek_needed_samples) {
-                samples_to_do=seek_needed_samples-decode_pos_samples;
-                if (samples_to_do>max_buffer_samples) samples_to_do=max_buffer_samples;
-            } else
-                seek_needed_samples = -1;
+            decode_pos_samples = seek_needed_samples;
+            decode_pos_ms = decode_pos_samples*1000LL/vgmstream->sample_rate;
+            seek_needed_samples = -1;
 
             input_module.outMod->Flush((int)decode_pos_ms);
         }
 
-        l = (samples_to_do*vgmstream->channels*2)<<(input_module.dsp_isactive()?1:0);
+        l = (max_buffer_samples*vgmstream->channels*2)<<(input_module.dsp_isactive()?1:0);
 
-        if (samples_to_do == 0) {
-            input_module.outMod->CanWrite();    /* ? */
-            if (!input_module.outMod->IsPlaying()) {
-                PostMessage(input_module.hMainWindow,   /* message dest */
-                        WM_WA_MPEG_EOF,     /* message id */
-                        0,0);   /* no parameters */
-                return 0;
-            }
-            Sleep(10);
-        }
-        else if (seek_needed_samples != -1) {
-            render_vgmstream(sample_buffer,samples_to_do,vgmstream);
+        if (input_module.outMod->CanWrite() >= l) {
+            /* let vgmstream do its thing, fade included, it knows where the
+             * stream ends */
+            samples_to_do = render_vgmstream_play(sample_buffer,max_buffer_samples,vgmstream);
 
-            decode_pos_samples+=samples_to_do;
-            decode_pos_ms=decode_pos_samples*1000LL/vgmstream->sample_rate;
-        }
-        else if (input_module.outMod->CanWrite() >= l) {
-            /* let vgmstream do its thing */
-            render_vgmstream(sample_buffer,samples_to_do,vgmstream);
-
-            /* fade! */
-            if (vgmstream->loop_flag && fade_samples > 0 && !loop_forever) {
-                int samples_into_fade = decode_pos_samples - (stream_length_samples - fade_samples);
-                if (samples_into_fade + samples_to_do > 0) {
-                    int j,k;
-                    for (j=0;j<samples_to_do;j++,samples_into_fade++) {
-                        if (samples_into_fade > 0) {
-                            double fadedness = (double)(fade_samples-samples_into_fade)/fade_samples;
-                            for (k=0;k<vgmstream->channels;k++) {
-                                sample_buffer[j*vgmstream->channels+k] =
-                                    (short)(sample_buffer[j*vgmstream->channels+k]*fadedness);
-                            }
-                        }
-                    }
+            if (samples_to_do == 0) {
+                if (!input_module.outMod->IsPlaying()) {
+                    PostMessage(input_module.hMainWindow,   /* message dest */
+                            WM_WA_MPEG_EOF,     /* message id */
+                            0,0);   /* no parameters */
+                    return 0;
                 }
+                Sleep(10);
+                continue;
             }
 
             input_module.SAAddPCMData((char*)sample_buffer,vgmstream->channels,16,decode_pos_ms);
             input_module.VSAAddPCMData((char*)sample_buffer,vgmstream->channels,16,decode_pos_ms);
             decode_pos_samples+=samples_to_do;
             decode_pos_ms=decode_pos_samples*1000LL/vgmstream->sample_rate;
+            l = samples_to_do*vgmstream->channels*2;
             if (input_module.dsp_isactive())
                 l =input_module.dsp_dosamples(sample_buffer,samples_to_do,16,vgmstream->channels,vgmstream->sample_rate) * 
                     2 * vgmstream->channels;